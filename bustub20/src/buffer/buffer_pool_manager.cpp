@@ -12,25 +12,53 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+#include <algorithm>
 #include <list>
 #include <unordered_map>
+#include <utility>
+
+#include "common/logger.h"
 
 namespace bustub {
 
 BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
+    : pool_size_(pool_size), frame_arena_(pool_size),
+      frame_descriptors_(pool_size),
+      disk_manager_(disk_manager), log_manager_(log_manager) {
   // We allocate a consecutive memory space for the buffer pool.
   pages_ = new Page[pool_size_];
+  frame_arena_.BindPages(pages_);
+  frame_descriptors_.BindPages(pages_);
   replacer_ = new LRUReplacer(pool_size);
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
   }
+  if (disk_manager_ != nullptr && disk_manager_->GetIOMode() == DiskIOMode::MMAP_READ_ONLY) {
+    //映射里每个page一个Page对象，数据直接指向映射，不再换出
+    size_t num_pages = disk_manager_->GetNumMappedPages();
+    mapped_pages_ = new Page[num_pages];
+    mapped_descriptors_ = std::make_unique<FrameDescriptorTable>(num_pages);
+    mapped_descriptors_->BindPages(mapped_pages_);
+    for (size_t i = 0; i < num_pages; i++) {
+      //Page的接口不区分只读，往映射里写会直接segfault
+      mapped_pages_[i].data_ = const_cast<char *>(disk_manager_->GetMappedPage(static_cast<page_id_t>(i)));
+      mapped_descriptors_->Reset(static_cast<frame_id_t>(i), static_cast<page_id_t>(i));
+    }
+  }
+  prefetch_thread_ = std::thread(&BufferPoolManager::RunPrefetcher, this);
 }
 
 BufferPoolManager::~BufferPoolManager() {
+  {
+    std::lock_guard<std::mutex> _g(prefetch_latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_one();
+  prefetch_thread_.join();
   delete[] pages_;
+  delete[] mapped_pages_;
   delete replacer_;
 }
 
@@ -42,46 +70,99 @@ frame_id_t BufferPoolManager::_get_frame() {
   }
   auto fid = -1;
   if (replacer_->Victim(&fid)) {
+    replacer_->Remove(fid);
     //获取到了过期page，若page为脏，需要
     // 2.     If R is dirty, write it back to the disk.
     // 3.     Delete R from the page table
-    auto &p = pages_[fid];
-    if (p.is_dirty_) {
-      disk_manager_->WritePage(p.page_id_, p.data_);
-      p.is_dirty_=false;
+    auto old_pid = frame_descriptors_.GetPageId(fid);
+    bool dirty = frame_descriptors_.IsDirty(fid);
+    if (dirty) {
+      _write_back_frame(fid);
     }
-    page_table_.erase(p.page_id_);
+    counters_.RecordEviction(dirty);
+    page_table_.erase(old_pid);
     return fid;
   }
   return -1;
 }
 
+void BufferPoolManager::_write_back_frame(frame_id_t fid) {
+  //WAL：page上最后一次修改的日志要先落盘，page才能写
+  if (enable_logging && log_manager_ != nullptr && pages_[fid].GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush(pages_[fid].GetLSN());
+  }
+  auto start = std::chrono::steady_clock::now();
+  disk_manager_->WritePage(frame_descriptors_.GetPageId(fid), pages_[fid].data_);
+  counters_.RecordWriteBack(std::chrono::steady_clock::now() - start);
+  frame_descriptors_.SetDirty(fid, false);
+}
+
+bool BufferPoolManager::_drop_stale_copy(page_id_t pid) {
+  auto f = page_table_.find(pid);
+  if (f == page_table_.end()) {
+    return true;
+  }
+  //删掉的page被prefetch之类读回来了，没人用的话直接扔，不用写回
+  if (frame_descriptors_.GetPinCount(f->second) > 0) {
+    return false;
+  }
+  replacer_->Remove(f->second);
+  frame_descriptors_.Reset(f->second, INVALID_PAGE_ID);
+  free_list_.push_back(f->second);
+  page_table_.erase(f);
+  return true;
+}
+
+Page *BufferPoolManager::_fetch_mapped_page(page_id_t pid) {
+  if (pid < 0 || static_cast<size_t>(pid) >= mapped_descriptors_->GetNumFrames()) {
+    return nullptr;
+  }
+  //不用latch_，pin计数本身是原子的
+  mapped_descriptors_->PinCountUp(pid);
+  //第一次fetch时校验checksum，之后page不会变，不再算；两个线程同时第一次fetch最多多算一次
+  if (!mapped_descriptors_->IsReferenced(pid)) {
+    mapped_descriptors_->SetReferenced(pid);
+    if (disk_manager_->HasPageChecksums()) {
+      disk_manager_->VerifyPage(pid, mapped_pages_[pid].data_);
+    }
+  }
+  counters_.RecordHit();
+  return &mapped_pages_[pid];
+}
+
 void BufferPoolManager::_disk_load_page_data_2_frame(
   page_id_t pid,frame_id_t fid
 ){
   //数据读入
   disk_manager_->ReadPage(pid,pages_[fid].data_);
   //pageid
-  pages_[fid].page_id_=pid;
+  frame_descriptors_.Reset(fid, pid);
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   //pagetable更新
   page_table_[pid]=fid;
   //引用计数
-  pages_[fid].pin_count_=1;
+  frame_descriptors_.PinCountUp(fid);
+  frame_descriptors_.SetReferenced(fid);
 }
 
 Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
+  if (mapped_pages_ != nullptr) {
+    return _fetch_mapped_page(page_id);
+  }
   //获取指定pageid 的page
-  std::lock_guard<std::mutex> _g(latch_);
+  auto _g = counters_.LockAndRecordWait(&latch_);
 
   // 1.     Search the page table for the requested page (P).
   auto f = page_table_.find(page_id);
   // 1.1    If P exists, pin it and return it immediately.
   if (f != page_table_.end()) {
-    pages_[f->second].pin_count_++;
+    frame_descriptors_.PinCountUp(f->second);
+    frame_descriptors_.SetReferenced(f->second);
     replacer_->Pin(f->second);
+    counters_.RecordHit();
     return &pages_[f->second];
   }
+  counters_.RecordMiss();
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
   //        Note that pages are always found from the free list first.
   // 2.     If R is dirty, write it back to the disk.
@@ -100,24 +181,201 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
   return &pages_[fid];
 }
 
+std::vector<Page *> BufferPoolManager::FetchPages(const std::vector<page_id_t> &page_ids) {
+  if (mapped_pages_ != nullptr) {
+    std::vector<Page *> result;
+    for (auto pid : page_ids) {
+      result.push_back(_fetch_mapped_page(pid));
+    }
+    return result;
+  }
+  auto _g = counters_.LockAndRecordWait(&latch_);
+  std::vector<Page *> result(page_ids.size(), nullptr);
+  //miss的page先占好frame，最后一次性读盘
+  std::vector<page_id_t> read_ids;
+  std::vector<char *> read_buffers;
+  for (size_t i = 0; i < page_ids.size(); i++) {
+    auto f = page_table_.find(page_ids[i]);
+    if (f != page_table_.end()) {
+      //同一批里重复的page也走这里
+      frame_descriptors_.PinCountUp(f->second);
+      frame_descriptors_.SetReferenced(f->second);
+      replacer_->Pin(f->second);
+      counters_.RecordHit();
+      result[i] = &pages_[f->second];
+      continue;
+    }
+    counters_.RecordMiss();
+    auto fid = _get_frame();
+    if (fid < 0) continue;
+
+    frame_descriptors_.Reset(fid, page_ids[i]);
+    page_table_[page_ids[i]] = fid;
+    frame_descriptors_.PinCountUp(fid);
+    frame_descriptors_.SetReferenced(fid);
+    read_ids.push_back(page_ids[i]);
+    read_buffers.push_back(pages_[fid].data_);
+    result[i] = &pages_[fid];
+  }
+  disk_manager_->ReadPages(read_ids, read_buffers);
+  return result;
+}
+
+void BufferPoolManager::Prefetch(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  //映射的page让内核在后台读
+  if (mapped_pages_ != nullptr) {
+    if (disk_manager_->AdviseMapped(AccessPattern::WILLNEED, page_id, 1)) {
+      counters_.RecordPrefetched(1);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> _g(prefetch_latch_);
+    //只是提示，队列满了直接丢
+    if (prefetch_queue_.size() >= PREFETCH_QUEUE_SIZE) {
+      return;
+    }
+    prefetch_queue_.push_back(page_id);
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManager::AdviseAccess(AccessPattern pattern, page_id_t first_page, size_t num_pages) {
+  if (mapped_pages_ != nullptr) {
+    disk_manager_->AdviseMapped(pattern, first_page, num_pages);
+  }
+}
+
+void BufferPoolManager::SetStatsDumpInterval(std::chrono::milliseconds interval) {
+  {
+    std::lock_guard<std::mutex> _g(prefetch_latch_);
+    stats_dump_interval_ = interval;
+    next_stats_dump_ = std::chrono::steady_clock::now() + interval;
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManager::RunPrefetcher() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    //要定时输出统计的话，最多睡到下一次输出；输出间隔改了也要醒过来重新算
+    auto interval = stats_dump_interval_;
+    auto woken = [this, interval] {
+      return prefetch_stop_ || !prefetch_queue_.empty() || stats_dump_interval_ != interval;
+    };
+    if (interval.count() > 0) {
+      prefetch_cv_.wait_until(lock, next_stats_dump_, woken);
+    } else {
+      prefetch_cv_.wait(lock, woken);
+    }
+    if (prefetch_stop_) {
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (stats_dump_interval_.count() > 0 && now >= next_stats_dump_) {
+      LOG_INFO("buffer pool: %s", counters_.Snapshot().ToString().c_str());
+      next_stats_dump_ = now + stats_dump_interval_;
+    }
+    if (prefetch_queue_.empty()) {
+      continue;
+    }
+    std::vector<page_id_t> hinted(prefetch_queue_.begin(), prefetch_queue_.end());
+    prefetch_queue_.clear();
+    lock.unlock();
+
+    std::vector<page_id_t> read_ids;
+    std::vector<char *> read_buffers;
+    {
+      std::lock_guard<std::mutex> _g(latch_);
+      for (auto pid : hinted) {
+        //已经在内存里的不动，也不去碰它在replacer里的位置
+        if (page_table_.count(pid) > 0 || std::find(read_ids.begin(), read_ids.end(), pid) != read_ids.end()) {
+          continue;
+        }
+        auto fid = _get_frame();
+        if (fid < 0) break;
+        //读进来不pin，直接进replacer，等着被FetchPage命中
+        frame_descriptors_.Reset(fid, pid);
+        page_table_[pid] = fid;
+        replacer_->Unpin(fid);
+        read_ids.push_back(pid);
+        read_buffers.push_back(pages_[fid].data_);
+      }
+      disk_manager_->ReadPages(read_ids, read_buffers);
+    }
+    counters_.RecordPrefetched(read_ids.size());
+    lock.lock();
+  }
+}
+
+BasicPageGuard BufferPoolManager::FetchPageBasic(page_id_t page_id) {
+  auto page = FetchPage(page_id);
+  if (page == nullptr) {
+    return {};
+  }
+  return {this, page};
+}
+
+ReadPageGuard BufferPoolManager::FetchPageRead(page_id_t page_id) {
+  auto page = FetchPage(page_id);
+  if (page == nullptr) {
+    return {};
+  }
+  page->RLatch();
+  return {this, page};
+}
+
+WritePageGuard BufferPoolManager::FetchPageWrite(page_id_t page_id) {
+  auto page = FetchPage(page_id);
+  if (page == nullptr) {
+    return {};
+  }
+  page->WLatch();
+  return {this, page};
+}
+
+BasicPageGuard BufferPoolManager::NewPageGuarded(page_id_t *page_id) {
+  auto page = NewPage(page_id);
+  if (page == nullptr) {
+    return {};
+  }
+  BasicPageGuard guard(this, page);
+  guard.MarkDirty();
+  return guard;
+}
+
 bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
+  if (mapped_pages_ != nullptr) {
+    //映射是只读的，is_dirty没有意义
+    int pin_count;
+    return page_id >= 0 && static_cast<size_t>(page_id) < mapped_descriptors_->GetNumFrames() &&
+           mapped_descriptors_->TryUnpin(page_id, &pin_count);
+  }
   std::lock_guard<std::mutex> _g(latch_);
   // pin计数为0时，放入replacer
   auto fid = page_table_[page_id];
-  if (pages_[fid].pin_count_ == 0) {
+  if (frame_descriptors_.GetPinCount(fid) == 0) {
     return false;
   }
-  pages_[fid].is_dirty_ =pages_[fid].is_dirty_|| is_dirty;
-  pages_[fid].pin_count_--;
-  if (pages_[fid].pin_count_ == 0) {
+  if (is_dirty) {
+    frame_descriptors_.SetDirty(fid, true);
+  }
+  if (frame_descriptors_.PinCountDown(fid) == 0) {
     replacer_->Unpin(fid);
   }
   // printf("unpin page %d, left refcnt %d\n",
-  //   page_id,pages_[fid].pin_count_);
+  //   page_id,frame_descriptors_.GetPinCount(fid));
   return true;
 }
 
 bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
+  if (mapped_pages_ != nullptr) {
+    //映射的page不会脏，没东西要写
+    return page_id >= 0 && static_cast<size_t>(page_id) < mapped_descriptors_->GetNumFrames();
+  }
   std::lock_guard<std::mutex> _g(latch_);
 
   auto f = page_table_.find(page_id);
@@ -125,15 +383,19 @@ bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
     return false;
   }
   // Make sure you call DiskManager::WritePage!
-  if (pages_[f->second].is_dirty_) {
-    disk_manager_->WritePage(page_id, pages_[f->second].data_);
-    pages_[f->second].is_dirty_=false;
+  if (frame_descriptors_.IsDirty(f->second)) {
+    _write_back_frame(f->second);
   }
   return true;
 }
 
 Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
-  std::lock_guard<std::mutex> _g(latch_);
+  if (mapped_pages_ != nullptr) {
+    //只读
+    *page_id = INVALID_PAGE_ID;
+    return nullptr;
+  }
+  auto _g = counters_.LockAndRecordWait(&latch_);
   //磁盘上创建新的page
 
   auto fid = _get_frame();
@@ -146,16 +408,26 @@ Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
   // 2.   Pick a victim page P from either the free list or the replacer. 
   //      Always pick from the free list first.
   // 0.   Make sure you call DiskManager::AllocatePage!
+  //释放过的page id会被复用；旧副本还被pin着的id先跳过，拿到新id之后再还回去
   auto pid=disk_manager_->AllocatePage();
+  std::vector<page_id_t> skipped;
+  while (!_drop_stale_copy(pid)) {
+    skipped.push_back(pid);
+    pid = disk_manager_->AllocatePage();
+  }
+  for (auto skipped_pid : skipped) {
+    disk_manager_->DeallocatePage(skipped_pid);
+  }
   // _disk_load_page_data_2_frame(pid,fid);
   {
     //pageid
-    pages_[fid].page_id_=pid;
+    frame_descriptors_.Reset(fid, pid);
     // 3.   Update P's metadata, zero out memory and add P to the page table.
     //pagetable更新
     page_table_[pid]=fid;
     //引用计数
-    pages_[fid].pin_count_=1;
+    frame_descriptors_.PinCountUp(fid);
+    frame_descriptors_.SetReferenced(fid);
   }
   *page_id=pid;
   // 4.   Set the page ID output parameter. Return a pointer to P.
@@ -163,25 +435,32 @@ Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
 }
 
 bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
+  if (mapped_pages_ != nullptr) {
+    return false;
+  }
   std::lock_guard<std::mutex> _g(latch_);
 
   // 1.   Search the page table for the requested page (P).
   auto f=page_table_.find(page_id);
   // 1.   If P does not exist, return true.
   if(f==page_table_.end()){
+    disk_manager_->DeallocatePage(page_id);
     return true;
   }
-  auto &page=pages_[f->second];
+  auto pin_count=frame_descriptors_.GetPinCount(f->second);
 
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
-  if(page.pin_count_>0){
-    printf("delete failed, page pin cnt %d\n",page.pin_count_);
+  if(pin_count>0){
+    printf("delete failed, page pin cnt %d\n",pin_count);
     return false;
   }
   
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  page_table_.erase(page_id);
+  //从replacer拿掉，免得同一个frame既在free list又在replacer
+  replacer_->Remove(f->second);
+  frame_descriptors_.Reset(f->second, INVALID_PAGE_ID);
   free_list_.push_back(f->second);
+  page_table_.erase(f);
   // 0.   Make sure you call DiskManager::DeallocatePage!
   disk_manager_->DeallocatePage(page_id);
 
@@ -190,14 +469,90 @@ bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
 
 void BufferPoolManager::FlushAllPagesImpl() {
   std::lock_guard<std::mutex> _g(latch_);
-  for(auto &p:page_table_){
-    if(pages_[p.second].is_dirty_){
-      pages_[p.second].is_dirty_=false;
-      auto &page=pages_[p.second];
-      disk_manager_->WritePage(page.page_id_,page.data_);
-    }
+  //只扫脏页位图，干净的frame一次跳过64个
+  for (auto fid = frame_descriptors_.FindDirty(0); fid >= 0; fid = frame_descriptors_.FindDirty(fid + 1)) {
+    _write_back_frame(fid);
   }
   // You can do it!
 }
 
+BasicPageGuard::BasicPageGuard(BasicPageGuard &&that) noexcept
+    : bpm_(that.bpm_), page_(that.page_), is_dirty_(that.is_dirty_) {
+  that.bpm_ = nullptr;
+  that.page_ = nullptr;
+  that.is_dirty_ = false;
+}
+
+BasicPageGuard &BasicPageGuard::operator=(BasicPageGuard &&that) noexcept {
+  if (this != &that) {
+    //先还掉自己手上的page
+    Drop();
+    bpm_ = that.bpm_;
+    page_ = that.page_;
+    is_dirty_ = that.is_dirty_;
+    that.bpm_ = nullptr;
+    that.page_ = nullptr;
+    that.is_dirty_ = false;
+  }
+  return *this;
+}
+
+void BasicPageGuard::Drop() {
+  if (page_ == nullptr) {
+    return;
+  }
+  bpm_->UnpinPage(page_->GetPageId(), is_dirty_);
+  bpm_ = nullptr;
+  page_ = nullptr;
+  is_dirty_ = false;
+}
+
+ReadPageGuard BasicPageGuard::UpgradeRead() {
+  ReadPageGuard read_guard;
+  if (page_ != nullptr) {
+    page_->RLatch();
+    read_guard.guard_ = std::move(*this);
+  }
+  return read_guard;
+}
+
+WritePageGuard BasicPageGuard::UpgradeWrite() {
+  WritePageGuard write_guard;
+  if (page_ != nullptr) {
+    page_->WLatch();
+    write_guard.guard_ = std::move(*this);
+  }
+  return write_guard;
+}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void ReadPageGuard::Drop() {
+  if (guard_.page_ != nullptr) {
+    guard_.page_->RUnlatch();
+  }
+  guard_.Drop();
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&that) noexcept {
+  if (this != &that) {
+    Drop();
+    guard_ = std::move(that.guard_);
+  }
+  return *this;
+}
+
+void WritePageGuard::Drop() {
+  if (guard_.page_ != nullptr) {
+    guard_.page_->WUnlatch();
+  }
+  guard_.Drop();
+}
+
 }  // namespace bustub
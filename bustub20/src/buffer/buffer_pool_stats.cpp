@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+namespace bustub {
+
+double BufferPoolStats::HitRatio() const {
+  uint64_t fetches = hits + misses;
+  return fetches == 0 ? 0 : static_cast<double>(hits) / static_cast<double>(fetches);
+}
+
+uint64_t BufferPoolStats::FlushLatencyPercentileUs(double percentile) const {
+  uint64_t total = 0;
+  for (auto count : flush_latency_us) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  //落在第几个写回上，至少是第一个
+  auto rank = static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(total)));
+  rank = rank == 0 ? 1 : rank;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < FLUSH_LATENCY_BUCKETS; i++) {
+    seen += flush_latency_us[i];
+    if (seen >= rank) {
+      return uint64_t{1} << i;
+    }
+  }
+  return uint64_t{1} << (FLUSH_LATENCY_BUCKETS - 1);
+}
+
+BufferPoolStats &BufferPoolStats::operator+=(const BufferPoolStats &other) {
+  hits += other.hits;
+  misses += other.misses;
+  evictions += other.evictions;
+  dirty_evictions += other.dirty_evictions;
+  write_backs += other.write_backs;
+  prefetched += other.prefetched;
+  pin_waits += other.pin_waits;
+  pin_wait_ns += other.pin_wait_ns;
+  for (size_t i = 0; i < FLUSH_LATENCY_BUCKETS; i++) {
+    flush_latency_us[i] += other.flush_latency_us[i];
+  }
+  return *this;
+}
+
+std::string BufferPoolStats::ToString() const {
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "hits=%" PRIu64 " misses=%" PRIu64 " hit_ratio=%.4f evictions=%" PRIu64 " dirty_evictions=%" PRIu64
+           " write_backs=%" PRIu64 " flush_p50_us<=%" PRIu64 " flush_p99_us<=%" PRIu64 " pin_waits=%" PRIu64
+           " pin_wait_us=%" PRIu64 " prefetched=%" PRIu64,
+           hits, misses, HitRatio(), evictions, dirty_evictions, write_backs, FlushLatencyPercentileUs(0.5),
+           FlushLatencyPercentileUs(0.99), pin_waits, pin_wait_ns / 1000, prefetched);
+  return buf;
+}
+
+void BufferPoolCounters::RecordWriteBack(std::chrono::nanoseconds latency) {
+  write_backs_.fetch_add(1, std::memory_order_relaxed);
+  //按微秒数的二进制位数分桶：<1us进0号桶，[2^(i-1), 2^i)进i号桶
+  auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+  size_t bucket = 0;
+  while (us != 0 && bucket + 1 < BufferPoolStats::FLUSH_LATENCY_BUCKETS) {
+    us >>= 1;
+    bucket++;
+  }
+  flush_latency_us_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::unique_lock<std::mutex> BufferPoolCounters::LockAndRecordWait(std::mutex *latch) {
+  std::unique_lock<std::mutex> lock(*latch, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    pin_waits_.fetch_add(1, std::memory_order_relaxed);
+    pin_wait_ns_.fetch_add(waited.count(), std::memory_order_relaxed);
+  }
+  return lock;
+}
+
+BufferPoolStats BufferPoolCounters::Snapshot() const {
+  BufferPoolStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.dirty_evictions = dirty_evictions_.load(std::memory_order_relaxed);
+  stats.write_backs = write_backs_.load(std::memory_order_relaxed);
+  stats.prefetched = prefetched_.load(std::memory_order_relaxed);
+  stats.pin_waits = pin_waits_.load(std::memory_order_relaxed);
+  stats.pin_wait_ns = pin_wait_ns_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < BufferPoolStats::FLUSH_LATENCY_BUCKETS; i++) {
+    stats.flush_latency_us[i] = flush_latency_us_[i].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+}  // namespace bustub
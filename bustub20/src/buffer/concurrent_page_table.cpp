@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// concurrent_page_table.cpp
+//
+// Identification: src/buffer/concurrent_page_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/concurrent_page_table.h"
+
+namespace bustub {
+
+ConcurrentPageTable::ConcurrentPageTable(size_t num_frames) {
+  // 负载因子控制在 3/7 以下，探测链一般只有一个bucket
+  size_t want = num_frames / 3 + 1;
+  num_buckets_ = 1;
+  while (num_buckets_ < want) {
+    num_buckets_ <<= 1;
+  }
+  bucket_mask_ = num_buckets_ - 1;
+  buckets_ = new Bucket[num_buckets_];
+  for (size_t b = 0; b < num_buckets_; b++) {
+    for (size_t s = 0; s < SLOTS_PER_BUCKET; s++) {
+      buckets_[b].page_ids_[s].store(EMPTY_SLOT, std::memory_order_relaxed);
+      buckets_[b].frame_ids_[s].store(-1, std::memory_order_relaxed);
+    }
+  }
+}
+
+ConcurrentPageTable::~ConcurrentPageTable() { delete[] buckets_; }
+
+size_t ConcurrentPageTable::HomeBucket(page_id_t page_id) const {
+  // page id 基本是连续(或按实例数跨步)分配的，乘法哈希打散
+  uint64_t h = static_cast<uint32_t>(page_id) * 0x9E3779B97F4A7C15ULL;
+  return static_cast<size_t>(h >> 32) & bucket_mask_;
+}
+
+ConcurrentPageTable::ProbeResult ConcurrentPageTable::ProbeBucket(const Bucket &bucket, page_id_t page_id,
+                                                                  frame_id_t *frame_id) const {
+  while (true) {
+    uint32_t v1 = bucket.version_.load(std::memory_order_acquire);
+    if ((v1 & 1) != 0) {
+      continue;
+    }
+    ProbeResult res = ProbeResult::CONTINUE;
+    frame_id_t fid = -1;
+    for (size_t s = 0; s < SLOTS_PER_BUCKET; s++) {
+      if (bucket.page_ids_[s].load(std::memory_order_relaxed) == page_id) {
+        fid = bucket.frame_ids_[s].load(std::memory_order_relaxed);
+        res = ProbeResult::FOUND;
+        break;
+      }
+    }
+    if (res != ProbeResult::FOUND && bucket.overflow_.load(std::memory_order_relaxed) == 0) {
+      res = ProbeResult::STOP;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (bucket.version_.load(std::memory_order_relaxed) == v1) {
+      if (res == ProbeResult::FOUND) {
+        *frame_id = fid;
+      }
+      return res;
+    }
+    // 读的过程中有写者修改了这个bucket，重读
+  }
+}
+
+bool ConcurrentPageTable::Find(page_id_t page_id, frame_id_t *frame_id) const {
+  size_t b = HomeBucket(page_id);
+  for (size_t i = 0; i < num_buckets_; i++) {
+    switch (ProbeBucket(buckets_[b], page_id, frame_id)) {
+      case ProbeResult::FOUND:
+        return true;
+      case ProbeResult::STOP:
+        return false;
+      case ProbeResult::CONTINUE:
+        break;
+    }
+    b = (b + 1) & bucket_mask_;
+  }
+  return false;
+}
+
+void ConcurrentPageTable::BeginWrite(Bucket *bucket) {
+  bucket->version_.store(bucket->version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ConcurrentPageTable::EndWrite(Bucket *bucket) {
+  bucket->version_.store(bucket->version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool ConcurrentPageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  BUSTUB_ASSERT(page_id != EMPTY_SLOT, "cannot insert INVALID_PAGE_ID");
+  frame_id_t unused;
+  if (Find(page_id, &unused)) {
+    return false;
+  }
+  size_t home = HomeBucket(page_id);
+  size_t b = home;
+  for (size_t i = 0; i < num_buckets_; i++) {
+    Bucket &bucket = buckets_[b];
+    for (size_t s = 0; s < SLOTS_PER_BUCKET; s++) {
+      if (bucket.page_ids_[s].load(std::memory_order_relaxed) != EMPTY_SLOT) {
+        continue;
+      }
+      // 先把沿途bucket的overflow加上，再写入slot，读者不会因为overflow为0提前停下
+      for (size_t p = home; p != b; p = (p + 1) & bucket_mask_) {
+        BeginWrite(&buckets_[p]);
+        buckets_[p].overflow_.fetch_add(1, std::memory_order_relaxed);
+        EndWrite(&buckets_[p]);
+      }
+      BeginWrite(&bucket);
+      bucket.frame_ids_[s].store(frame_id, std::memory_order_relaxed);
+      bucket.page_ids_[s].store(page_id, std::memory_order_relaxed);
+      EndWrite(&bucket);
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    b = (b + 1) & bucket_mask_;
+  }
+  UNREACHABLE("page table is sized for the pool and can never be full");
+}
+
+bool ConcurrentPageTable::Remove(page_id_t page_id) {
+  size_t home = HomeBucket(page_id);
+  size_t b = home;
+  for (size_t i = 0; i < num_buckets_; i++) {
+    Bucket &bucket = buckets_[b];
+    for (size_t s = 0; s < SLOTS_PER_BUCKET; s++) {
+      if (bucket.page_ids_[s].load(std::memory_order_relaxed) != page_id) {
+        continue;
+      }
+      // 与Insert相反：先清slot，再减沿途的overflow
+      BeginWrite(&bucket);
+      bucket.page_ids_[s].store(EMPTY_SLOT, std::memory_order_relaxed);
+      bucket.frame_ids_[s].store(-1, std::memory_order_relaxed);
+      EndWrite(&bucket);
+      for (size_t p = home; p != b; p = (p + 1) & bucket_mask_) {
+        BeginWrite(&buckets_[p]);
+        buckets_[p].overflow_.fetch_sub(1, std::memory_order_relaxed);
+        EndWrite(&buckets_[p]);
+      }
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    if (bucket.overflow_.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+    b = (b + 1) & bucket_mask_;
+  }
+  return false;
+}
+
+}  // namespace bustub
@@ -0,0 +1,133 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+namespace {
+// <numaif.h>里的值，不为了一个常量去依赖libnuma
+constexpr int MPOL_PREFERRED_MODE = 1;
+constexpr size_t MAX_NUMA_NODES = 1024;
+
+size_t RoundUp(size_t n, size_t align) { return (n + align - 1) / align * align; }
+}  // namespace
+
+FrameArena::FrameArena(size_t num_frames, const FrameArenaOptions &options)
+    : num_frames_(num_frames), length_(num_frames * PAGE_SIZE) {
+  if (options.use_huge_pages) {
+    length_ = RoundUp(length_, HUGE_PAGE_SIZE);
+    if (!MapHugeTLB()) {
+      //系统没有预留大页，退回透明大页：按2MB对齐，内核才能整块换成大页
+      MapAligned(HUGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+      huge_pages_ = madvise(base_, length_, MADV_HUGEPAGE) == 0;
+#endif
+    }
+  } else {
+    MapAligned(PAGE_SIZE);
+  }
+  //第一次写之前绑好，物理页才会分配在这个node上
+  if (options.numa_node >= 0) {
+    numa_bound_ = BindToNode(options.numa_node);
+  }
+}
+
+FrameArena::~FrameArena() { munmap(base_, length_); }
+
+bool FrameArena::MapHugeTLB() {
+#ifdef MAP_HUGETLB
+  void *p = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    base_ = static_cast<char *>(p);
+    huge_pages_ = true;
+    return true;
+  }
+#endif
+  return false;
+}
+
+void FrameArena::MapAligned(size_t align) {
+  //多映射align大小，再把两头多出来的部分还掉
+  size_t extra = align > PAGE_SIZE ? align : 0;
+  void *p = mmap(nullptr, length_ + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "FrameArena: cannot map buffer pool memory");
+  }
+  auto raw = reinterpret_cast<uintptr_t>(p);
+  auto aligned = RoundUp(raw, align);
+  if (aligned > raw) {
+    munmap(p, aligned - raw);
+  }
+  if (raw + length_ + extra > aligned + length_) {
+    munmap(reinterpret_cast<void *>(aligned + length_), raw + length_ + extra - (aligned + length_));
+  }
+  base_ = reinterpret_cast<char *>(aligned);
+}
+
+bool FrameArena::BindToNode(int node) {
+#ifdef SYS_mbind
+  if (static_cast<size_t>(node) >= MAX_NUMA_NODES) {
+    return false;
+  }
+  unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = {};  // NOLINT
+  nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+  //preferred而不是bind：这个node内存不够时宁可跨node，也不要分配失败
+  return syscall(SYS_mbind, base_, length_, MPOL_PREFERRED_MODE, nodemask, MAX_NUMA_NODES, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+size_t FrameArena::ReleaseFrames(frame_id_t first, size_t count) {
+  //只能按映射的页大小整块归还，两头不满一块的留着
+  size_t granule = huge_pages_ ? HUGE_PAGE_SIZE : PAGE_SIZE;
+  size_t begin = RoundUp(static_cast<size_t>(first) * PAGE_SIZE, granule);
+  size_t end = (static_cast<size_t>(first) + count) * PAGE_SIZE / granule * granule;
+  if (begin >= end || madvise(base_ + begin, end - begin, MADV_DONTNEED) != 0) {
+    return 0;
+  }
+  return end - begin;
+}
+
+void FrameArena::BindPages(Page *pages) {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    pages[i].data_ = FrameData(static_cast<frame_id_t>(i));
+  }
+}
+
+int FrameArena::NumNumaNodes() {
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir == nullptr) {
+    return 1;
+  }
+  int nodes = 0;
+  while (auto *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+      nodes++;
+    }
+  }
+  closedir(dir);
+  return nodes > 0 ? nodes : 1;
+}
+
+}  // namespace bustub
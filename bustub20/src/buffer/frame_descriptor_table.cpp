@@ -0,0 +1,66 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_descriptor_table.cpp
+//
+// Identification: src/buffer/frame_descriptor_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_descriptor_table.h"
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+FrameDescriptorTable::FrameDescriptorTable(size_t num_frames)
+    : num_frames_(num_frames),
+      num_words_((num_frames + BITS_PER_WORD - 1) / BITS_PER_WORD),
+      page_ids_(new std::atomic<page_id_t>[num_frames]),
+      pin_counts_(new std::atomic<int>[num_frames]),
+      dirty_bits_(new std::atomic<uint64_t>[num_words_]),
+      ref_bits_(new std::atomic<uint64_t>[num_words_]) {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    page_ids_[i].store(INVALID_PAGE_ID, std::memory_order_relaxed);
+    pin_counts_[i].store(0, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < num_words_; ++i) {
+    dirty_bits_[i].store(0, std::memory_order_relaxed);
+    ref_bits_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+FrameDescriptorTable::~FrameDescriptorTable() {
+  delete[] page_ids_;
+  delete[] pin_counts_;
+  delete[] dirty_bits_;
+  delete[] ref_bits_;
+}
+
+void FrameDescriptorTable::BindPages(Page *pages) {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    pages[i].descriptors_ = this;
+    pages[i].frame_id_ = static_cast<frame_id_t>(i);
+  }
+}
+
+frame_id_t FrameDescriptorTable::FindDirty(size_t from) const {
+  if (from >= num_frames_) {
+    return -1;
+  }
+  size_t word = from / BITS_PER_WORD;
+  //第一个word要先去掉from之前的位
+  uint64_t bits = dirty_bits_[word].load(std::memory_order_acquire) & (~uint64_t{0} << (from % BITS_PER_WORD));
+  while (bits == 0) {
+    if (++word == num_words_) {
+      return -1;
+    }
+    bits = dirty_bits_[word].load(std::memory_order_acquire);
+  }
+  return static_cast<frame_id_t>(word * BITS_PER_WORD + __builtin_ctzll(bits));
+}
+
+}  // namespace bustub
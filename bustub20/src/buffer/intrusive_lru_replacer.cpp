@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer.cpp
+//
+// Identification: src/buffer/intrusive_lru_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/intrusive_lru_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+IntrusiveLRUReplacer::IntrusiveLRUReplacer(size_t num_pages)
+    : head_(static_cast<frame_id_t>(num_pages)), nodes_(num_pages + 1) {
+  //空链表：head自己指向自己
+  for (auto &node : nodes_) {
+    node.prev_ = node.next_ = head_;
+    node.linked_ = false;
+  }
+}
+
+IntrusiveLRUReplacer::~IntrusiveLRUReplacer() = default;
+
+void IntrusiveLRUReplacer::Unlink(frame_id_t frame_id) {
+  auto &node = nodes_[frame_id];
+  nodes_[node.prev_].next_ = node.next_;
+  nodes_[node.next_].prev_ = node.prev_;
+  node.linked_ = false;
+  size_--;
+}
+
+bool IntrusiveLRUReplacer::Victim(frame_id_t *frame_id) {
+  std::lock_guard<std::mutex> _g(latch);
+  if (size_ == 0) return false;
+
+  *frame_id = nodes_[head_].next_;
+  Unlink(*frame_id);
+  return true;
+}
+
+void IntrusiveLRUReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  std::lock_guard<std::mutex> _g(latch);
+  if (!nodes_[frame_id].linked_) return;
+
+  Unlink(frame_id);
+}
+
+void IntrusiveLRUReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(frame_id >= 0 && frame_id < head_, "frame id out of range");
+  std::lock_guard<std::mutex> _g(latch);
+  if (nodes_[frame_id].linked_) return;
+
+  //挂到队尾(head的prev)，最近unpin的最后淘汰
+  auto &node = nodes_[frame_id];
+  node.prev_ = nodes_[head_].prev_;
+  node.next_ = head_;
+  nodes_[node.prev_].next_ = frame_id;
+  nodes_[head_].prev_ = frame_id;
+  node.linked_ = true;
+  size_++;
+}
+
+void IntrusiveLRUReplacer::EvictionOrder(std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> _g(latch);
+  frame_ids->clear();
+  for (auto fid = nodes_[head_].next_; fid != head_; fid = nodes_[fid].next_) {
+    frame_ids->push_back(fid);
+  }
+}
+
+size_t IntrusiveLRUReplacer::Size() {
+  std::lock_guard<std::mutex> _g(latch);
+  return size_;
+}
+
+}  // namespace bustub
@@ -0,0 +1,136 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k)
+    : k_(k),
+      pending_accesses_(new std::atomic<size_t>[num_pages]),
+      history_(num_pages),
+      evictable_(num_pages, false) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs k >= 1");
+  for (size_t i = 0; i < num_pages; i++) {
+    pending_accesses_[i].store(NO_ACCESS, std::memory_order_relaxed);
+  }
+}
+
+LRUKReplacer::~LRUKReplacer() { delete[] pending_accesses_; }
+
+LRUKReplacer::Entry LRUKReplacer::KeyOf(frame_id_t frame_id) const {
+  // history只保留最近k次，front就是倒数第k次(不足k次时是最早那次)
+  return {history_[frame_id].front(), frame_id};
+}
+
+std::set<LRUKReplacer::Entry> &LRUKReplacer::QueueOf(frame_id_t frame_id) {
+  return history_[frame_id].size() < k_ ? young_ : old_;
+}
+
+void LRUKReplacer::AddAccess(frame_id_t frame_id, size_t timestamp) {
+  auto &history = history_[frame_id];
+  history.push_back(timestamp);
+  if (history.size() > k_) history.pop_front();
+}
+
+bool LRUKReplacer::TakePendingAccess(frame_id_t frame_id) {
+  size_t timestamp = pending_accesses_[frame_id].exchange(NO_ACCESS, std::memory_order_relaxed);
+  auto &history = history_[frame_id];
+  //时间戳是在锁外拿的，可能比unpin记下的那次还早，那次已经算过了
+  if (timestamp == NO_ACCESS || (!history.empty() && timestamp <= history.back())) return false;
+
+  bool evictable = evictable_[frame_id];
+  if (evictable) QueueOf(frame_id).erase(KeyOf(frame_id));
+  AddAccess(frame_id, timestamp);
+  if (evictable) QueueOf(frame_id).insert(KeyOf(frame_id));
+  return true;
+}
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::lock_guard<std::mutex> _g(latch);
+  while (true) {
+    //不足k次访问的优先淘汰，扫描只碰一次的page不会挤掉热点
+    auto &queue = young_.empty() ? old_ : young_;
+    if (queue.empty()) return false;
+
+    //命中留下的访问只会让key变新，排在最前面的补上之后换了位置就重新挑
+    *frame_id = queue.begin()->second;
+    if (!TakePendingAccess(*frame_id)) break;
+  }
+  auto &queue = young_.empty() ? old_ : young_;
+  queue.erase(queue.begin());
+  evictable_[*frame_id] = false;
+  //历史先留着：调用者可能拿不到这个frame(被命中pin住了)，之后unpin回来还是热的；真换page时调用者会Remove
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> _g(latch);
+  if (!evictable_[frame_id]) return;
+
+  TakePendingAccess(frame_id);
+  QueueOf(frame_id).erase(KeyOf(frame_id));
+  evictable_[frame_id] = false;
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> _g(latch);
+  if (evictable_[frame_id]) return;
+
+  //一次pin到unpin算一次访问，pin着的时候命中留下的访问也算在这一次里
+  pending_accesses_[frame_id].store(NO_ACCESS, std::memory_order_relaxed);
+  AddAccess(frame_id, current_timestamp_.fetch_add(1, std::memory_order_relaxed));
+  QueueOf(frame_id).insert(KeyOf(frame_id));
+  evictable_[frame_id] = true;
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> _g(latch);
+  if (evictable_[frame_id]) {
+    QueueOf(frame_id).erase(KeyOf(frame_id));
+    evictable_[frame_id] = false;
+  }
+  //frame回free list，下一个page不能带着上一个page的访问历史进old_
+  history_[frame_id].clear();
+  pending_accesses_[frame_id].store(NO_ACCESS, std::memory_order_relaxed);
+}
+
+bool LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  //命中路径不拿latch，只记下时间戳；不在replacer里的frame等它unpin时这次访问会被算进去
+  pending_accesses_[frame_id].store(current_timestamp_.fetch_add(1, std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+  return true;
+}
+
+void LRUKReplacer::EvictionOrder(std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> _g(latch);
+  //和Victim的顺序一样：先是不足k次访问的，再是满k次的；命中留下的访问先都补上
+  for (size_t i = 0; i < evictable_.size(); i++) {
+    if (evictable_[i]) TakePendingAccess(static_cast<frame_id_t>(i));
+  }
+  frame_ids->clear();
+  for (auto &entry : young_) {
+    frame_ids->push_back(entry.second);
+  }
+  for (auto &entry : old_) {
+    frame_ids->push_back(entry.second);
+  }
+}
+
+size_t LRUKReplacer::Size() {
+  std::lock_guard<std::mutex> _g(latch);
+  return young_.size() + old_.size();
+}
+
+}  // namespace bustub
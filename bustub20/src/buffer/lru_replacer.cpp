@@ -63,6 +63,12 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
   searchnode[frame_id] = iter;
 }
 
+void LRUReplacer::EvictionOrder(std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> _g(latch);
+  //队头先被淘汰
+  frame_ids->assign(queue.begin(), queue.end());
+}
+
 size_t LRUReplacer::Size() {
   std::lock_guard<std::mutex> _g(latch);
   return queue.size();
@@ -0,0 +1,192 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define BUSTUB_HAVE_SSE42_CRC32
+#endif
+
+namespace bustub {
+
+namespace {
+
+/** Reflected CRC-32C polynomial. */
+constexpr uint32_t POLY = 0x82f63b78;
+/** Stream lengths of the three-way hardware loop, powers of two so that the shift operators are easy to build. */
+constexpr size_t LONG_STREAM = 1024;
+constexpr size_t SHORT_STREAM = 256;
+
+/**
+ * Lookup tables. A shift table appends n zero bytes to a CRC in four lookups, which is how the CRCs of three streams
+ * over adjacent blocks are combined into the CRC of all of them (see Mark Adler's crc32c.c).
+ */
+struct Crc32cTables {
+  uint32_t bytes[256];
+  uint32_t long_shift[4][256];
+  uint32_t short_shift[4][256];
+
+  Crc32cTables() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t crc = n;
+      for (int k = 0; k < 8; k++) {
+        crc = (crc & 1) != 0 ? (crc >> 1) ^ POLY : crc >> 1;
+      }
+      bytes[n] = crc;
+    }
+    BuildShift(long_shift, LONG_STREAM);
+    BuildShift(short_shift, SHORT_STREAM);
+  }
+
+  static uint32_t MatrixTimes(const uint32_t *mat, uint32_t vec) {
+    uint32_t sum = 0;
+    for (; vec != 0; vec >>= 1, mat++) {
+      if ((vec & 1) != 0) {
+        sum ^= *mat;
+      }
+    }
+    return sum;
+  }
+
+  static void MatrixSquare(uint32_t *square, const uint32_t *mat) {
+    for (int n = 0; n < 32; n++) {
+      square[n] = MatrixTimes(mat, mat[n]);
+    }
+  }
+
+  /** Operator over GF(2) that appends length zero bytes, length a power of two. */
+  static void ZerosOperator(uint32_t *even, size_t length) {
+    uint32_t odd[32];
+    // one zero bit
+    odd[0] = POLY;
+    for (int n = 1; n < 32; n++) {
+      odd[n] = uint32_t{1} << (n - 1);
+    }
+    // two, then four zero bits
+    MatrixSquare(even, odd);
+    MatrixSquare(odd, even);
+    // every square doubles the number of zero bytes, starting from one
+    while (true) {
+      MatrixSquare(even, odd);
+      length >>= 1;
+      if (length == 0) {
+        return;
+      }
+      MatrixSquare(odd, even);
+      length >>= 1;
+      if (length == 0) {
+        memcpy(even, odd, sizeof(odd));
+        return;
+      }
+    }
+  }
+
+  static void BuildShift(uint32_t shift[4][256], size_t length) {
+    uint32_t op[32];
+    ZerosOperator(op, length);
+    for (uint32_t n = 0; n < 256; n++) {
+      for (int byte = 0; byte < 4; byte++) {
+        shift[byte][n] = MatrixTimes(op, n << (8 * byte));
+      }
+    }
+  }
+};
+
+const Crc32cTables &Tables() {
+  static const Crc32cTables tables;
+  return tables;
+}
+
+#ifdef BUSTUB_HAVE_SSE42_CRC32
+
+uint32_t Shift(const uint32_t shift[4][256], uint32_t crc) {
+  return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+uint64_t Load(const char *data) {
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+/** Run the three streams over the next 3 * stream bytes and fold them into crc. */
+__attribute__((target("sse4.2"))) uint64_t ThreeStreams(const char **data, size_t stream,
+                                                        const uint32_t shift[4][256], uint64_t crc0) {
+  uint64_t crc1 = 0;
+  uint64_t crc2 = 0;
+  const char *block = *data;
+  for (size_t i = 0; i < stream; i += 8) {
+    crc0 = _mm_crc32_u64(crc0, Load(block + i));
+    crc1 = _mm_crc32_u64(crc1, Load(block + stream + i));
+    crc2 = _mm_crc32_u64(crc2, Load(block + 2 * stream + i));
+  }
+  crc0 = Shift(shift, static_cast<uint32_t>(crc0)) ^ crc1;
+  crc0 = Shift(shift, static_cast<uint32_t>(crc0)) ^ crc2;
+  *data = block + 3 * stream;
+  return crc0;
+}
+
+__attribute__((target("sse4.2"))) uint32_t ChecksumHardware(const char *data, size_t length, uint32_t crc) {
+  const auto &tables = Tables();
+  uint64_t crc0 = crc ^ 0xffffffff;
+  while (length >= 3 * LONG_STREAM) {
+    crc0 = ThreeStreams(&data, LONG_STREAM, tables.long_shift, crc0);
+    length -= 3 * LONG_STREAM;
+  }
+  while (length >= 3 * SHORT_STREAM) {
+    crc0 = ThreeStreams(&data, SHORT_STREAM, tables.short_shift, crc0);
+    length -= 3 * SHORT_STREAM;
+  }
+  for (; length >= 8; data += 8, length -= 8) {
+    crc0 = _mm_crc32_u64(crc0, Load(data));
+  }
+  for (; length > 0; data++, length--) {
+    crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), static_cast<uint8_t>(*data));
+  }
+  return static_cast<uint32_t>(crc0) ^ 0xffffffff;
+}
+
+#endif
+
+}  // namespace
+
+uint32_t Crc32c::Checksum(const char *data, size_t length, uint32_t crc) {
+#ifdef BUSTUB_HAVE_SSE42_CRC32
+  if (HasHardwareSupport()) {
+    return ChecksumHardware(data, length, crc);
+  }
+#endif
+  return ChecksumSoftware(data, length, crc);
+}
+
+uint32_t Crc32c::ChecksumSoftware(const char *data, size_t length, uint32_t crc) {
+  const auto &tables = Tables();
+  crc ^= 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc = tables.bytes[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+bool Crc32c::HasHardwareSupport() {
+#ifdef BUSTUB_HAVE_SSE42_CRC32
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+}  // namespace bustub
@@ -0,0 +1,203 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4.cpp
+//
+// Identification: src/common/util/lz4.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz4.h"
+
+#include <cstring>
+
+namespace bustub {
+
+namespace {
+
+/** Shortest match worth a sequence. */
+constexpr size_t MIN_MATCH = 4;
+/** The last bytes of a block are always literals. */
+constexpr size_t LAST_LITERALS = 5;
+/** No match may start in the last bytes of a block. */
+constexpr size_t MATCH_FIND_LIMIT = 12;
+/** Farthest back a match may reach, offsets are 16 bits. */
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_LOG = 12;
+/** Every 64 positions without a match, the search skips one more byte, so incompressible data goes quickly. */
+constexpr int SKIP_STRENGTH = 6;
+
+uint32_t Read32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_LOG); }
+
+/** Write a length that did not fit into its 4 token bits: runs of 255, then the rest. */
+uint8_t *WriteLength(uint8_t *op, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+/** Read the continuation of a length whose token bits were 15. */
+bool ReadLength(const uint8_t **ip, const uint8_t *iend, size_t *length) {
+  uint8_t byte;
+  do {
+    if (*ip >= iend) {
+      return false;
+    }
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Append a sequence: literals, then a match unless match_length is 0.
+ * @return the end of the sequence, nullptr if it does not fit before oend
+ */
+uint8_t *WriteSequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t literal_length,
+                       size_t offset, size_t match_length) {
+  // token + length bytes + literals + offset + length bytes
+  size_t worst = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+  if (worst > static_cast<size_t>(oend - op)) {
+    return nullptr;
+  }
+  uint8_t *token = op++;
+  *token = static_cast<uint8_t>(literal_length >= 15 ? 15 << 4 : literal_length << 4);
+  if (literal_length >= 15) {
+    op = WriteLength(op, literal_length - 15);
+  }
+  memcpy(op, literals, literal_length);
+  op += literal_length;
+  if (match_length == 0) {
+    return op;
+  }
+  *op++ = static_cast<uint8_t>(offset);
+  *op++ = static_cast<uint8_t>(offset >> 8);
+  size_t length = match_length - MIN_MATCH;
+  *token |= static_cast<uint8_t>(length >= 15 ? 15 : length);
+  if (length >= 15) {
+    op = WriteLength(op, length - 15);
+  }
+  return op;
+}
+
+}  // namespace
+
+size_t Lz4::Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+  if (src_size > MAX_INPUT_SIZE) {
+    return 0;
+  }
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *op = reinterpret_cast<uint8_t *>(dst);
+  const uint8_t *oend = op + dst_capacity;
+  size_t anchor = 0;
+
+  if (src_size > MATCH_FIND_LIMIT) {
+    // positions of the last 4-byte sequences seen per hash; stale entries are caught by comparing the bytes
+    uint16_t table[1 << HASH_LOG] = {0};
+    const size_t match_limit = src_size - LAST_LITERALS;
+    const size_t start_limit = src_size - MATCH_FIND_LIMIT;
+    size_t ip = 1;
+    while (ip <= start_limit) {
+      uint32_t sequence = Read32(in + ip);
+      uint32_t hash = Hash(sequence);
+      size_t ref = table[hash];
+      table[hash] = static_cast<uint16_t>(ip);
+      if (ref >= ip || ip - ref > MAX_OFFSET || Read32(in + ref) != sequence) {
+        ip += 1 + ((ip - anchor) >> SKIP_STRENGTH);
+        continue;
+      }
+      // extend the match backwards into the pending literals, then forwards
+      while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+        ip--;
+        ref--;
+      }
+      size_t length = MIN_MATCH;
+      while (ip + length < match_limit && in[ref + length] == in[ip + length]) {
+        length++;
+      }
+      op = WriteSequence(op, oend, in + anchor, ip - anchor, ip - ref, length);
+      if (op == nullptr) {
+        return 0;
+      }
+      ip += length;
+      anchor = ip;
+      if (ip - 2 <= start_limit) {
+        table[Hash(Read32(in + ip - 2))] = static_cast<uint16_t>(ip - 2);
+      }
+    }
+  }
+
+  op = WriteSequence(op, oend, in + anchor, src_size - anchor, 0, 0);
+  if (op == nullptr) {
+    return 0;
+  }
+  return op - reinterpret_cast<uint8_t *>(dst);
+}
+
+bool Lz4::Decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+  const auto *ip = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *iend = ip + src_size;
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  uint8_t *op = out;
+  uint8_t *oend = out + dst_size;
+  while (true) {
+    if (ip >= iend) {
+      return false;
+    }
+    uint8_t token = *ip++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(&ip, iend, &literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<size_t>(iend - ip) || literal_length > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    memcpy(op, ip, literal_length);
+    op += literal_length;
+    ip += literal_length;
+    // the last sequence has no match
+    if (ip == iend) {
+      break;
+    }
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - out)) {
+      return false;
+    }
+    size_t match_length = token & 15;
+    if (match_length == 15 && !ReadLength(&ip, iend, &match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (match_length > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    const uint8_t *match = op - offset;
+    if (offset >= match_length) {
+      memcpy(op, match, match_length);
+    } else {
+      // overlapping match, e.g. a run of one repeated byte: copy forward byte by byte
+      for (size_t i = 0; i < match_length; i++) {
+        op[i] = match[i];
+      }
+    }
+    op += match_length;
+  }
+  return op == oend;
+}
+
+}  // namespace bustub
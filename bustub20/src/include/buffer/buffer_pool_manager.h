@@ -12,11 +12,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <type_traits>
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/frame_arena.h"
+#include "buffer/frame_descriptor_table.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -85,8 +96,17 @@ struct Unique{
     }
 };
 }
+
+class BasicPageGuard;
+class ReadPageGuard;
+class WritePageGuard;
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * Over a disk manager in MMAP_READ_ONLY mode it serves the pages straight from the mapping of the db file instead:
+ * fetches copy nothing, take no frame and never evict, so any number of pages can be pinned at once. Such a buffer
+ * pool is read-only: NewPage and DeletePage fail, and the page data must not be written to.
  */
 class BufferPoolManager {
  public:
@@ -153,6 +173,71 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetch and pin a batch of pages with a single latch acquisition. All misses are read from disk in one batch.
+   * Every non-null result must be unpinned by the caller, once per occurrence of its page id in the batch.
+   * @param page_ids ids of the pages to fetch
+   * @return one page per page id, nullptr where no frame was available
+   */
+  std::vector<Page *> FetchPages(const std::vector<page_id_t> &page_ids);
+
+  /**
+   * Hint that page_id will be fetched soon. The page is read in the background and left unpinned in the replacer, so
+   * the FetchPage that follows is a hit. Hints are dropped when the page is already resident, no frame is free, or too
+   * many hints are queued. page_id must be an allocated page.
+   * @param page_id id of the page to read ahead
+   */
+  void Prefetch(page_id_t page_id);
+
+  /**
+   * Hint how pages will be fetched. Only a buffer pool over an MMAP_READ_ONLY disk manager acts on it, by passing it on
+   * to the mapping (see DiskManager::AdviseMapped); other buffer pools read whole pages on demand and ignore it.
+   * @param pattern access pattern of the pages, e.g. SEQUENTIAL before a table scan, RANDOM before index lookups
+   * @param first_page first page the hint applies to
+   * @param num_pages number of pages the hint applies to, 0 for all pages from first_page on
+   */
+  void AdviseAccess(AccessPattern pattern, page_id_t first_page = 0, size_t num_pages = 0);
+
+  /** @return the number of pages read by Prefetch so far */
+  size_t GetNumPrefetched() { return counters_.Snapshot().prefetched; }
+
+  /** @return a snapshot of the hit/miss/eviction/write-back counters */
+  BufferPoolStats GetStats() { return counters_.Snapshot(); }
+
+  /**
+   * Periodically log the counters through LOG_INFO.
+   * @param interval time between two dumps, 0 turns dumping off (the default)
+   */
+  void SetStatsDumpInterval(std::chrono::milliseconds interval);
+
+  /**
+   * Fetch and pin a page; the returned guard unpins it when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if no frame was available
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id);
+
+  /**
+   * Fetch, pin and read-latch a page; the returned guard unlatches and unpins it when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if no frame was available
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id);
+
+  /**
+   * Fetch, pin and write-latch a page; the returned guard unlatches and unpins it when it goes out of scope.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if no frame was available
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id);
+
+  /**
+   * Create a new page, pinned by the returned guard. New pages always start out dirty.
+   * @param[out] page_id id of created page
+   * @return a guard holding the page, empty if no new page could be created
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id);
+
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
@@ -220,15 +305,34 @@ class BufferPoolManager {
   frame_id_t _get_frame();
   void _disk_load_page_data_2_frame(
     page_id_t pid,frame_id_t fid);
+  //写回一个脏frame，记下写盘耗时
+  void _write_back_frame(frame_id_t fid);
+  //复用的page id在内存里还有删除之后又被读回来的旧副本时丢掉它；旧副本被pin着返回false
+  bool _drop_stale_copy(page_id_t pid);
+  //只读mmap模式：pin住映射里的page直接返回，不拷贝也不占frame
+  Page *_fetch_mapped_page(page_id_t pid);
+
+  /** Background prefetcher loop: drain the hint queue and read the pages in one batch. Also dumps the counters. */
+  void RunPrefetcher();
+
+  /** Maximum number of queued Prefetch hints, further hints are dropped. */
+  static constexpr size_t PREFETCH_QUEUE_SIZE = 64;
 
   /** Number of pages in the buffer pool. */
   size_t pool_size_;
+  /** Memory holding the data of all frames. */
+  FrameArena frame_arena_;
+  /** Page id, pin count, dirty and reference bit of every frame. */
+  FrameDescriptorTable frame_descriptors_;
   /** Array of buffer pool pages. */
   Page *pages_;
+  /** MMAP_READ_ONLY disk manager: one page per page of the mapping, page i bound to frame i for good. */
+  Page *mapped_pages_ = nullptr;
+  std::unique_ptr<FrameDescriptorTable> mapped_descriptors_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
   //pageid 绑定到的内存块
   std::unordered_map<page_id_t, frame_id_t> page_table_;
@@ -238,8 +342,146 @@ class BufferPoolManager {
   std::list<frame_id_t> free_list_;
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
   std::mutex latch_;
+  /** Prefetch hints waiting for the prefetcher thread, protected by prefetch_latch_. */
+  std::deque<page_id_t> prefetch_queue_;
+  std::thread prefetch_thread_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  bool prefetch_stop_ = false;
+  /** Hit/miss/eviction/write-back counters, see GetStats(). */
+  BufferPoolCounters counters_;
+  /** Stats dump schedule of the prefetcher thread, protected by prefetch_latch_. */
+  std::chrono::milliseconds stats_dump_interval_{0};
+  std::chrono::steady_clock::time_point next_stats_dump_;
 };
-class PageBorrower{
-  
+
+/**
+ * BasicPageGuard borrows a pinned page from the buffer pool and unpins it exactly once: when the guard is destroyed,
+ * overwritten by a move, or Drop()ed. The page is unpinned as dirty only if the holder asked for mutable access.
+ * Guards are move-only; a moved-from guard is empty and releases nothing.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  BasicPageGuard &operator=(const BasicPageGuard &) = delete;
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+  ~BasicPageGuard() { Drop(); }
+
+  /** Unpin the page now. The guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  explicit operator bool() const { return page_ != nullptr; }
+
+  page_id_t PageId() { return page_->GetPageId(); }
+  Page *GetPage() { return page_; }
+
+  /**
+   * Read access. T is either a Page subclass (TablePage, HeaderPage) or a layout placed on the page data (B+ tree
+   * pages). Most page classes are not const-correct, so this hands out a mutable pointer without dirtying the page.
+   */
+  template <class T>
+  T *As() {
+    if constexpr (std::is_base_of_v<Page, T>) {
+      return static_cast<T *>(page_);
+    } else {
+      return reinterpret_cast<T *>(page_->GetData());
+    }
+  }
+
+  /** Write access: the page will be unpinned as dirty. */
+  template <class T>
+  T *AsMut() {
+    is_dirty_ = true;
+    return As<T>();
+  }
+
+  /** Record that the page was modified through a pointer obtained earlier. */
+  void MarkDirty() { is_dirty_ = true; }
+
+  /** Latch the page for reading and hand the pin over to a ReadPageGuard. This guard is empty afterwards. */
+  ReadPageGuard UpgradeRead();
+
+  /** Latch the page for writing and hand the pin over to a WritePageGuard. This guard is empty afterwards. */
+  WritePageGuard UpgradeWrite();
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_ = nullptr;
+  Page *page_ = nullptr;
+  bool is_dirty_ = false;
+};
+
+/** A pinned and read-latched page. The latch is released before the pin. */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+  /** @param page must already be read-latched by the caller */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+  ~ReadPageGuard() { Drop(); }
+
+  /** Unlatch and unpin the page now. The guard is empty afterwards. */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+  page_id_t PageId() { return guard_.PageId(); }
+  Page *GetPage() { return guard_.GetPage(); }
+
+  template <class T>
+  T *As() {
+    return guard_.As<T>();
+  }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
 };
+
+/** A pinned and write-latched page. The latch is released before the pin. */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+  /** @param page must already be write-latched by the caller */
+  WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+  ~WritePageGuard() { Drop(); }
+
+  /** Unlatch and unpin the page now. The guard is empty afterwards. */
+  void Drop();
+
+  explicit operator bool() const { return static_cast<bool>(guard_); }
+  page_id_t PageId() { return guard_.PageId(); }
+  Page *GetPage() { return guard_.GetPage(); }
+
+  template <class T>
+  T *As() {
+    return guard_.As<T>();
+  }
+
+  template <class T>
+  T *AsMut() {
+    return guard_.AsMut<T>();
+  }
+
+  void MarkDirty() { guard_.MarkDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
 }  // namespace bustub
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/** Point-in-time copy of a buffer pool's counters, see BufferPoolCounters. */
+struct BufferPoolStats {
+  /** Number of buckets of the write-back latency histogram. */
+  static constexpr size_t FLUSH_LATENCY_BUCKETS = 20;
+
+  /** FetchPage calls served from a resident frame. */
+  uint64_t hits = 0;
+  /** FetchPage calls that had to go to disk. */
+  uint64_t misses = 0;
+  /** Frames taken from the replacer to make room for another page. */
+  uint64_t evictions = 0;
+  /** Evictions that had to write the victim back first, because nothing had flushed it yet. */
+  uint64_t dirty_evictions = 0;
+  /** Dirty pages written to disk, by eviction, flush calls or a background flusher. */
+  uint64_t write_backs = 0;
+  /** Pages read in the background by Prefetch() or sequential read-ahead, before anyone fetched them. */
+  uint64_t prefetched = 0;
+  /** Calls that found the buffer pool latch taken and had to wait for it. */
+  uint64_t pin_waits = 0;
+  /** Total time spent in those waits. */
+  uint64_t pin_wait_ns = 0;
+  /**
+   * Write-back latency histogram: bucket 0 counts writes under 1 us, bucket i writes of [2^(i-1), 2^i) us, the last
+   * bucket everything slower.
+   */
+  std::array<uint64_t, FLUSH_LATENCY_BUCKETS> flush_latency_us{};
+
+  /** @return hits / (hits + misses), 0 if there was no fetch yet */
+  double HitRatio() const;
+
+  /**
+   * @param percentile between 0 and 1
+   * @return upper bound in us of the histogram bucket holding that percentile of the write-backs, 0 without writes
+   */
+  uint64_t FlushLatencyPercentileUs(double percentile) const;
+
+  /** Add the counters of another buffer pool, e.g. to sum up the instances of a parallel buffer pool. */
+  BufferPoolStats &operator+=(const BufferPoolStats &other);
+
+  /** @return the counters on one line, for logging */
+  std::string ToString() const;
+};
+
+/**
+ * BufferPoolCounters is the counter block of one buffer pool. All counters are relaxed atomics, so recording never
+ * takes a latch and the hit path pays one uncontended increment; Snapshot() reads them one by one, so a snapshot
+ * taken under load is not a consistent cut, which is fine for monitoring.
+ */
+class BufferPoolCounters {
+ public:
+  BufferPoolCounters() = default;
+  ~BufferPoolCounters() = default;
+
+  DISALLOW_COPY_AND_MOVE(BufferPoolCounters);
+
+  void RecordHit() { hits_.fetch_add(1, std::memory_order_relaxed); }
+  void RecordMiss() { misses_.fetch_add(1, std::memory_order_relaxed); }
+  void RecordPrefetched(size_t num_pages) { prefetched_.fetch_add(num_pages, std::memory_order_relaxed); }
+
+  /** @param dirty whether the victim had to be written back, the write itself is recorded by RecordWriteBack */
+  void RecordEviction(bool dirty) {
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+    if (dirty) {
+      dirty_evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /** Record one page written back to disk, and how long the write took. */
+  void RecordWriteBack(std::chrono::nanoseconds latency);
+
+  /**
+   * Acquire latch, recording the wait if it is taken. An uncontended acquisition costs a try_lock and no clock reads.
+   * @return the held latch
+   */
+  std::unique_lock<std::mutex> LockAndRecordWait(std::mutex *latch);
+
+  /** @return a copy of all counters */
+  BufferPoolStats Snapshot() const;
+
+ private:
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> dirty_evictions_{0};
+  std::atomic<uint64_t> write_backs_{0};
+  std::atomic<uint64_t> prefetched_{0};
+  std::atomic<uint64_t> pin_waits_{0};
+  std::atomic<uint64_t> pin_wait_ns_{0};
+  std::array<std::atomic<uint64_t>, BufferPoolStats::FLUSH_LATENCY_BUCKETS> flush_latency_us_{};
+};
+
+}  // namespace bustub
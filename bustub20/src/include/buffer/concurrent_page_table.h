@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// concurrent_page_table.h
+//
+// Identification: src/include/buffer/concurrent_page_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * ConcurrentPageTable maps resident page ids to the frames that hold them.
+ *
+ * The table is open-addressed with a fixed number of cache-line sized buckets, sized from the number of frames so
+ * that it never has to grow. Every bucket carries a sequence number: lookups read a bucket optimistically and retry
+ * only if a writer touched it in the meantime, so a buffer hit never writes to shared memory. Instead of tombstones,
+ * each bucket counts how many entries probed past it; a lookup stops at the first bucket with no overflow.
+ *
+ * Find() may run concurrently with anything. Insert() and Remove() must be serialized by the caller (the buffer pool
+ * already holds its latch whenever it rebinds a frame).
+ */
+class ConcurrentPageTable {
+ public:
+  /**
+   * Create a new ConcurrentPageTable.
+   * @param num_frames the maximum number of entries the table will be required to store
+   */
+  explicit ConcurrentPageTable(size_t num_frames);
+
+  /**
+   * Destroys the ConcurrentPageTable.
+   */
+  ~ConcurrentPageTable();
+
+  DISALLOW_COPY_AND_MOVE(ConcurrentPageTable);
+
+  /**
+   * Latch-free lookup.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame holding the page, if found
+   * @return true if the page is in the table
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) const;
+
+  /**
+   * Insert a mapping. Writers must be externally serialized.
+   * @param page_id the page to insert, must not already be in the table
+   * @param frame_id the frame holding the page
+   * @return false if the page was already present
+   */
+  bool Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Remove a mapping. Writers must be externally serialized.
+   * @param page_id the page to remove
+   * @return false if the page was not present
+   */
+  bool Remove(page_id_t page_id);
+
+  /** @return the number of entries in the table */
+  size_t Size() const { return size_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr size_t SLOTS_PER_BUCKET = 7;
+  static constexpr page_id_t EMPTY_SLOT = INVALID_PAGE_ID;
+
+  /** One cache line: sequence number, overflow count and seven (page id, frame id) slots. */
+  struct alignas(64) Bucket {
+    /** Odd while a writer is modifying the bucket. */
+    std::atomic<uint32_t> version_{0};
+    /** Number of entries whose probe sequence passed through this bucket. */
+    std::atomic<uint32_t> overflow_{0};
+    std::atomic<page_id_t> page_ids_[SLOTS_PER_BUCKET];
+    std::atomic<frame_id_t> frame_ids_[SLOTS_PER_BUCKET];
+  };
+  static_assert(sizeof(Bucket) == 64, "a bucket should fill exactly one cache line");
+
+  /** Outcome of reading one bucket under its sequence number. */
+  enum class ProbeResult { FOUND, CONTINUE, STOP };
+
+  size_t HomeBucket(page_id_t page_id) const;
+  ProbeResult ProbeBucket(const Bucket &bucket, page_id_t page_id, frame_id_t *frame_id) const;
+  void BeginWrite(Bucket *bucket);
+  void EndWrite(Bucket *bucket);
+
+  size_t num_buckets_;
+  size_t bucket_mask_;
+  Bucket *buckets_;
+  std::atomic<size_t> size_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/** How a FrameArena places its memory. */
+struct FrameArenaOptions {
+  /**
+   * Back the arena with 2 MB pages. Explicit huge pages (MAP_HUGETLB) are tried first; if none are reserved, the arena
+   * falls back to 2 MB aligned memory with transparent huge pages requested through madvise.
+   */
+  bool use_huge_pages = false;
+  /** Prefer memory on this NUMA node, -1 leaves placement to the kernel. */
+  int numa_node = -1;
+};
+
+/**
+ * FrameArena holds the data of all frames of a buffer pool in one contiguous, PAGE_SIZE aligned mapping, so that the
+ * 4 KB frame data is not interleaved with the page metadata and latches. Frame i lives at offset i * PAGE_SIZE.
+ *
+ * The memory is mapped lazily and zeroed by the kernel, so an arena can be created for more frames than a buffer pool
+ * uses at first and only costs memory for the frames that are touched. Huge pages and NUMA placement are best effort: if the system
+ * does not support them, the arena still works with regular pages, and IsHugePageBacked()/IsNumaBound() tell what
+ * was actually obtained.
+ */
+class FrameArena {
+ public:
+  /**
+   * Map the memory for num_frames frames.
+   * @param num_frames number of frames
+   * @param options huge page and NUMA placement
+   */
+  explicit FrameArena(size_t num_frames, const FrameArenaOptions &options = {});
+
+  /**
+   * Unmap the arena. The pages bound to it must not be used afterwards.
+   */
+  ~FrameArena();
+
+  DISALLOW_COPY_AND_MOVE(FrameArena);
+
+  /** @return the data of frame frame_id */
+  char *FrameData(frame_id_t frame_id) { return base_ + static_cast<size_t>(frame_id) * PAGE_SIZE; }
+
+  /**
+   * Point the data of pages[0..num_frames) at the frames of this arena.
+   * @param pages page array of the buffer pool, at least num_frames long
+   */
+  void BindPages(Page *pages);
+
+  /**
+   * Hand the memory of frames [first, first + count) back to the OS, e.g. after a buffer pool shrank. The frames stay
+   * mapped and read as zeroes when they are used again. With huge pages, only whole huge pages inside the range are
+   * released.
+   * @return the number of bytes released
+   */
+  size_t ReleaseFrames(frame_id_t first, size_t count);
+
+  /** @return number of frames in the arena */
+  size_t GetNumFrames() const { return num_frames_; }
+
+  /** @return true if the arena is backed by explicit or transparent huge pages */
+  bool IsHugePageBacked() const { return huge_pages_; }
+
+  /** @return true if the arena memory was bound to the requested NUMA node */
+  bool IsNumaBound() const { return numa_bound_; }
+
+  /** @return number of NUMA nodes of this machine, 1 if it cannot be determined */
+  static int NumNumaNodes();
+
+  /** Huge page size used for alignment and rounding. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+ private:
+  /** Try to map length bytes with explicit huge pages. */
+  bool MapHugeTLB();
+  /** Map length bytes of regular memory, aligned to align. */
+  void MapAligned(size_t align);
+  /** Prefer the given NUMA node for the whole mapping; must run before the memory is touched. */
+  bool BindToNode(int node);
+
+  size_t num_frames_;
+  /** Size of the mapping, num_frames_ * PAGE_SIZE rounded up to the huge page size if huge pages are used. */
+  size_t length_;
+  char *base_ = nullptr;
+  bool huge_pages_ = false;
+  bool numa_bound_ = false;
+};
+
+}  // namespace bustub
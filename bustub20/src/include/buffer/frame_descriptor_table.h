@@ -0,0 +1,168 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_descriptor_table.h
+//
+// Identification: src/include/buffer/frame_descriptor_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+class Page;
+
+/**
+ * FrameDescriptorTable holds the book-keeping of every frame of a buffer pool as a structure of arrays: page ids and
+ * pin counts in dense arrays, dirty and reference flags in bitmaps with one bit per frame.
+ *
+ * The frame data lives in a FrameArena and the Page objects only forward to this table, so a sweep over the frames
+ * (the background flusher looking for dirty pages, eviction checks) reads a few cache lines per 64 frames instead of
+ * one cache line per 4 KB frame.
+ *
+ * Every field is atomic, so readers never see torn values. Changing which page a frame holds still has to be
+ * serialized by the buffer pool. A buffer pool that pins without its latch claims a frame (pin count CLAIMED) for as
+ * long as it is free, being loaded or being written back: TryPin fails on claimed frames, and TryClaim fails on
+ * pinned ones.
+ */
+class FrameDescriptorTable {
+ public:
+  /**
+   * Create a new FrameDescriptorTable. Every frame starts out free: no page, unpinned, clean, not referenced.
+   * @param num_frames number of frames of the buffer pool
+   */
+  explicit FrameDescriptorTable(size_t num_frames);
+
+  /**
+   * Destroys the FrameDescriptorTable.
+   */
+  ~FrameDescriptorTable();
+
+  DISALLOW_COPY_AND_MOVE(FrameDescriptorTable);
+
+  /**
+   * Make pages[i] report the metadata of frame i.
+   * @param pages page array of the buffer pool, at least num_frames long
+   */
+  void BindPages(Page *pages);
+
+  /** @return number of frames */
+  size_t GetNumFrames() const { return num_frames_; }
+
+  page_id_t GetPageId(frame_id_t frame_id) const { return page_ids_[frame_id].load(std::memory_order_acquire); }
+  void SetPageId(frame_id_t frame_id, page_id_t page_id) {
+    page_ids_[frame_id].store(page_id, std::memory_order_release);
+  }
+
+  int GetPinCount(frame_id_t frame_id) const { return pin_counts_[frame_id].load(std::memory_order_acquire); }
+  void SetPinCount(frame_id_t frame_id, int pin_count) {
+    pin_counts_[frame_id].store(pin_count, std::memory_order_release);
+  }
+  /** @return the pin count after the increment */
+  int PinCountUp(frame_id_t frame_id) { return pin_counts_[frame_id].fetch_add(1, std::memory_order_acq_rel) + 1; }
+  /** @return the pin count after the decrement */
+  int PinCountDown(frame_id_t frame_id) { return pin_counts_[frame_id].fetch_sub(1, std::memory_order_acq_rel) - 1; }
+
+  /** Pin count of a frame owned by the buffer pool itself: free, being loaded or being written back. */
+  static constexpr int CLAIMED = -1;
+
+  /**
+   * Pin a frame unless it is claimed. The caller still has to check that the frame holds the page it wants.
+   * @return false if the frame is claimed
+   */
+  bool TryPin(frame_id_t frame_id) {
+    int pin_count = pin_counts_[frame_id].load(std::memory_order_acquire);
+    do {
+      if (pin_count < 0) {
+        return false;
+      }
+    } while (!pin_counts_[frame_id].compare_exchange_weak(pin_count, pin_count + 1, std::memory_order_acq_rel));
+    return true;
+  }
+
+  /**
+   * Unpin a pinned frame.
+   * @param[out] pin_count the pin count after the decrement
+   * @return false if the frame was not pinned
+   */
+  bool TryUnpin(frame_id_t frame_id, int *pin_count) {
+    int old = pin_counts_[frame_id].load(std::memory_order_acquire);
+    do {
+      if (old <= 0) {
+        return false;
+      }
+    } while (!pin_counts_[frame_id].compare_exchange_weak(old, old - 1, std::memory_order_acq_rel));
+    *pin_count = old - 1;
+    return true;
+  }
+
+  /**
+   * Claim an unpinned frame; release it again with SetPinCount.
+   * @return false if the frame is pinned or already claimed
+   */
+  bool TryClaim(frame_id_t frame_id) {
+    int unpinned = 0;
+    return pin_counts_[frame_id].compare_exchange_strong(unpinned, CLAIMED, std::memory_order_acq_rel);
+  }
+
+  bool IsDirty(frame_id_t frame_id) const { return TestBit(dirty_bits_, frame_id); }
+  void SetDirty(frame_id_t frame_id, bool is_dirty) { AssignBit(dirty_bits_, frame_id, is_dirty); }
+
+  /** Reference bits are set on every pin and cleared by sweeps that want to skip recently used frames. */
+  bool IsReferenced(frame_id_t frame_id) const { return TestBit(ref_bits_, frame_id); }
+  void SetReferenced(frame_id_t frame_id) { AssignBit(ref_bits_, frame_id, true); }
+  /** @return whether the bit was set before it got cleared */
+  bool TestAndClearReferenced(frame_id_t frame_id) {
+    uint64_t mask = BitMask(frame_id);
+    return (ref_bits_[frame_id / BITS_PER_WORD].fetch_and(~mask, std::memory_order_acq_rel) & mask) != 0;
+  }
+
+  /**
+   * Find the next dirty frame, skipping 64 clean frames per bitmap word.
+   * @param from first frame to look at
+   * @return the first dirty frame >= from, or -1 if there is none
+   */
+  frame_id_t FindDirty(size_t from) const;
+
+  /** Bind frame_id to page_id as a clean and unreferenced frame. The pin count is left alone. */
+  void Reset(frame_id_t frame_id, page_id_t page_id) {
+    SetPageId(frame_id, page_id);
+    SetDirty(frame_id, false);
+    AssignBit(ref_bits_, frame_id, false);
+  }
+
+ private:
+  static constexpr size_t BITS_PER_WORD = 64;
+
+  static uint64_t BitMask(frame_id_t frame_id) { return uint64_t{1} << (static_cast<size_t>(frame_id) % BITS_PER_WORD); }
+  static bool TestBit(const std::atomic<uint64_t> *bits, frame_id_t frame_id) {
+    return (bits[frame_id / BITS_PER_WORD].load(std::memory_order_acquire) & BitMask(frame_id)) != 0;
+  }
+  static void AssignBit(std::atomic<uint64_t> *bits, frame_id_t frame_id, bool value) {
+    if (value) {
+      bits[frame_id / BITS_PER_WORD].fetch_or(BitMask(frame_id), std::memory_order_acq_rel);
+    } else {
+      bits[frame_id / BITS_PER_WORD].fetch_and(~BitMask(frame_id), std::memory_order_acq_rel);
+    }
+  }
+
+  size_t num_frames_;
+  size_t num_words_;
+  std::atomic<page_id_t> *page_ids_;
+  std::atomic<int> *pin_counts_;
+  std::atomic<uint64_t> *dirty_bits_;
+  std::atomic<uint64_t> *ref_bits_;
+};
+
+}  // namespace bustub
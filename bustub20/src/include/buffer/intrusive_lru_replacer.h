@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer.h
+//
+// Identification: src/include/buffer/intrusive_lru_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * IntrusiveLRUReplacer implements the same policy as LRUReplacer without allocating or hashing.
+ *
+ * Frame ids are dense in [0, num_pages), so the LRU list lives in an array indexed by frame id: every frame owns one
+ * preallocated node with prev/next links, and slot num_pages is the list head. Pin, Unpin and Victim are O(1).
+ */
+class IntrusiveLRUReplacer : public Replacer {
+ public:
+  /**
+   * Create a new IntrusiveLRUReplacer.
+   * @param num_pages the maximum number of pages the IntrusiveLRUReplacer will be required to store
+   */
+  explicit IntrusiveLRUReplacer(size_t num_pages);
+
+  /**
+   * Destroys the IntrusiveLRUReplacer.
+   */
+  ~IntrusiveLRUReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  size_t Size() override;
+
+  void EvictionOrder(std::vector<frame_id_t> *frame_ids) override;
+
+ private:
+  struct Node {
+    frame_id_t prev_;
+    frame_id_t next_;
+    bool linked_;
+  };
+
+  void Unlink(frame_id_t frame_id);
+
+  /** Index of the list head; head.next_ is the least recently unpinned frame. */
+  frame_id_t head_;
+  std::vector<Node> nodes_;
+  size_t size_{0};
+  std::mutex latch;
+};
+
+}  // namespace bustub
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>  // NOLINT
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The victim is the evictable frame whose K-th most recent access lies furthest in the past. Frames with fewer than K
+ * recorded accesses count as infinitely old and go first, oldest first access first, so a page touched once by a
+ * sequential scan is evicted before any page of the re-referenced working set.
+ *
+ * One access is recorded per Unpin, i.e. per time the frame's pin count drops back to zero, and per RecordAccess on a
+ * frame that is still evictable, i.e. a hit that pinned the frame without taking it out of the replacer. RecordAccess
+ * takes no latch: it only stamps the frame with a timestamp, and the stamp joins the history when the frame next comes
+ * up in Victim, Pin or EvictionOrder. Hits in between collapse into the latest one. The history of a frame survives
+ * Pin and Victim, and is dropped by Remove, when the frame gets a new page.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of past accesses considered, must be at least 1 (k == 1 behaves like LRU)
+   */
+  LRUKReplacer(size_t num_pages, size_t k);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  bool RecordAccess(frame_id_t frame_id) override;
+
+  size_t Size() override;
+
+  void EvictionOrder(std::vector<frame_id_t> *frame_ids) override;
+
+ private:
+  /** (ordering timestamp, frame id), ordered oldest first. */
+  using Entry = std::pair<size_t, frame_id_t>;
+
+  /** @return the queue key of the frame: its K-th most recent access, or its oldest one if it has fewer than K. */
+  Entry KeyOf(frame_id_t frame_id) const;
+  std::set<Entry> &QueueOf(frame_id_t frame_id);
+  /** Append an access timestamp to the history of the frame, keeping the k_ most recent. */
+  void AddAccess(frame_id_t frame_id, size_t timestamp);
+  /**
+   * Move the access RecordAccess stamped on the frame into its history, requeueing the frame if it is evictable.
+   * @return true if there was an access to move
+   */
+  bool TakePendingAccess(frame_id_t frame_id);
+
+  /** Stamp of a frame without an access from RecordAccess. */
+  static constexpr size_t NO_ACCESS = 0;
+
+  size_t k_;
+  /** Access timestamps, also drawn by RecordAccess without the latch. */
+  std::atomic<size_t> current_timestamp_{NO_ACCESS + 1};
+  /** Latest access RecordAccess stamped on every frame and the history has not taken in yet, or NO_ACCESS. */
+  std::atomic<size_t> *pending_accesses_;
+  /** Up to k_ most recent access timestamps of every frame, most recent at the back. */
+  std::vector<std::list<size_t>> history_;
+  std::vector<bool> evictable_;
+  /** Evictable frames with fewer than k_ accesses. */
+  std::set<Entry> young_;
+  /** Evictable frames with k_ accesses. */
+  std::set<Entry> old_;
+  std::mutex latch;
+};
+
+}  // namespace bustub
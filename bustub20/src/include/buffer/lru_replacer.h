@@ -45,6 +45,8 @@ class LRUReplacer : public Replacer {
 
   size_t Size() override;
 
+  void EvictionOrder(std::vector<frame_id_t> *frame_ids) override;
+
  private:
   size_t num_pages_;
   std::list<frame_id_t> queue;
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
@@ -25,7 +27,9 @@ class Replacer {
   virtual ~Replacer() = default;
 
   /**
-   * Remove the victim frame as defined by the replacement policy.
+   * Remove the victim frame as defined by the replacement policy. The replacer may still remember the frame's accesses,
+   * e.g. for when the caller cannot take the frame after all and unpins it again; call Remove once the frame really
+   * gets a new page.
    * @param[out] frame_id id of frame that was removed, nullptr if no victim was found
    * @return true if a victim frame was found, false otherwise
    */
@@ -43,8 +47,30 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Forget a frame whose page is gone, e.g. before it goes back to the free list: take it out of the replacer like Pin
+   * and drop anything the replacer remembers about it, so the next page in the frame starts over.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Record an access to a frame that was pinned without calling Pin, so it may still be in the replacer. Replacers
+   * that only order frames by unpin time ignore it and leave the access to the caller's reference bits.
+   * @param frame_id the id of the accessed frame
+   * @return true if the replacer ranks the frame by this access itself, false if the caller has to remember it
+   */
+  virtual bool RecordAccess(frame_id_t frame_id) { return false; }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
+
+  /**
+   * List the frames that can be victimized in the order Victim would pick them, the next victim first. Replacers that
+   * do not keep such an order leave the list empty.
+   * @param[out] frame_ids the victimizable frames
+   */
+  virtual void EvictionOrder(std::vector<frame_id_t> *frame_ids) {}
 };
 
 }  // namespace bustub
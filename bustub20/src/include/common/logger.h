@@ -171,9 +171,11 @@ void OutputLogHeader(const char *file, int line, const char *func, int level);
 // ex: [ERROR] [somefile.cpp:123:doSome()] 2008/07/06 10:00:00 -
 inline void OutputLogHeader(const char *file, int line, const char *func, int level) {
   time_t t = ::time(nullptr);
-  tm *curTime = localtime(&t);  // NOLINT
-  char time_str[32];            // FIXME
-  ::strftime(time_str, 32, LOG_LOG_TIME_FORMAT, curTime);
+  // Background threads of the buffer pool log concurrently; localtime() shares one static buffer.
+  tm cur_time;
+  localtime_r(&t, &cur_time);
+  char time_str[32];  // FIXME
+  ::strftime(time_str, 32, LOG_LOG_TIME_FORMAT, &cur_time);
   const char *type;
   switch (level) {
     case LOG_LEVEL_ERROR:
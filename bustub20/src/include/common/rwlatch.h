@@ -12,9 +12,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <climits>
 #include <condition_variable>  // NOLINT
-#include <mutex>               // NOLINT
+#include <cstdint>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 
 #include "common/macros.h"
 
@@ -93,4 +96,140 @@ class ReaderWriterLatch {
   bool writer_entered_{false};
 };
 
+/**
+ * Reader-Writer latch that spins with exponential backoff for a bounded time before it parks on a condition variable.
+ *
+ * Uncontended and briefly contended acquisitions are a single compare-and-swap on the latch word, so short critical
+ * sections never pay for a syscall; only threads that did not get the latch while spinning park, and unlocking only
+ * takes the mutex when somebody is parked. With writer preference, new readers stay out while a writer is waiting.
+ */
+class HybridReaderWriterLatch {
+ public:
+  /**
+   * @param prefer_writers if true, a waiting writer blocks new readers, so writers cannot starve
+   */
+  explicit HybridReaderWriterLatch(bool prefer_writers = true) : prefer_writers_(prefer_writers) {}
+  ~HybridReaderWriterLatch() = default;
+
+  DISALLOW_COPY(HybridReaderWriterLatch);
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    if (TryWLock()) {
+      return;
+    }
+    if (prefer_writers_) {
+      waiting_writers_.fetch_add(1);
+    }
+    if (!Spin([this] { return TryWLock(); })) {
+      Park([this] { return TryWLock(); });
+    }
+    if (prefer_writers_) {
+      waiting_writers_.fetch_sub(1);
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    state_.fetch_and(~WRITER);
+    WakeParked();
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    if (TryRLock()) {
+      return;
+    }
+    if (!Spin([this] { return TryRLock(); })) {
+      Park([this] { return TryRLock(); });
+    }
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() {
+    //最后一个读者走的时候，可能有写者在等
+    if (state_.fetch_sub(1) == 1) {
+      WakeParked();
+    }
+  }
+
+ private:
+  /** Latch word: the writer bit, or the number of readers. */
+  static constexpr uint32_t WRITER = 1U << 31;
+  /** Spin rounds before parking; round i pauses 2^i times, the last rounds also yield. */
+  static constexpr int SPIN_ROUNDS = 12;
+  static constexpr int YIELD_FROM_ROUND = 8;
+
+  bool TryWLock() {
+    uint32_t unlocked = 0;
+    return state_.compare_exchange_strong(unlocked, WRITER);
+  }
+
+  bool TryRLock() {
+    uint32_t state = state_.load();
+    do {
+      if ((state & WRITER) != 0 || (prefer_writers_ && waiting_writers_.load() > 0)) {
+        return false;
+      }
+    } while (!state_.compare_exchange_weak(state, state + 1));
+    return true;
+  }
+
+  static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  template <typename TryLock>
+  static bool Spin(TryLock try_lock) {
+    for (int round = 0; round < SPIN_ROUNDS; round++) {
+      for (int i = 0; i < (1 << round); i++) {
+        CpuRelax();
+      }
+      //持有者可能没在跑，后面几轮让出CPU
+      if (round >= YIELD_FROM_ROUND) {
+        std::this_thread::yield();
+      }
+      if (try_lock()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename TryLock>
+  void Park(TryLock try_lock) {
+    std::unique_lock<std::mutex> latch(park_mutex_);
+    //先登记再重试：解锁的一方改完latch字之后看parked_，两边总有一边能看到对方
+    parked_.fetch_add(1);
+    park_cv_.wait(latch, try_lock);
+    parked_.fetch_sub(1);
+  }
+
+  void WakeParked() {
+    if (parked_.load() > 0) {
+      std::lock_guard<std::mutex> guard(park_mutex_);
+      park_cv_.notify_all();
+    }
+  }
+
+  const bool prefer_writers_;
+  std::atomic<uint32_t> state_{0};
+  std::atomic<uint32_t> waiting_writers_{0};
+  std::atomic<uint32_t> parked_{0};
+  std::mutex park_mutex_;
+  std::condition_variable park_cv_;
+};
+
 }  // namespace bustub
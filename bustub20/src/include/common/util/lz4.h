@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4.h
+//
+// Identification: src/include/common/util/lz4.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * Compressor for the LZ4 block format: greedy LZ77 with a 64 KB window, byte-aligned sequences of literals and
+ * matches, no entropy coding. Compression does one hash lookup per position and decompression is mostly memcpy, which
+ * makes it cheap enough to run on every page read. Blocks are interchangeable with LZ4_compress_default and
+ * LZ4_decompress_safe of liblz4, but inputs are limited to 64 KB, plenty for a page.
+ */
+class Lz4 {
+ public:
+  /** Largest input Compress accepts. */
+  static constexpr size_t MAX_INPUT_SIZE = 65535;
+
+  /**
+   * Compress a block.
+   * @param src data to compress, at most MAX_INPUT_SIZE bytes
+   * @param src_size number of bytes
+   * @param[out] dst output buffer
+   * @param dst_capacity size of the output buffer
+   * @return size of the compressed block, 0 if it does not fit into dst_capacity bytes
+   */
+  static size_t Compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+
+  /**
+   * Decompress a block. Malformed input never reads or writes out of bounds.
+   * @param src compressed block
+   * @param src_size size of the compressed block
+   * @param[out] dst output buffer
+   * @param dst_size size the block decompresses to
+   * @return false if the block is malformed or does not decompress to exactly dst_size bytes
+   */
+  static bool Decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+};
+
+}  // namespace bustub
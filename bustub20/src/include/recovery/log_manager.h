@@ -13,9 +13,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,11 +27,22 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Commits are grouped: a committing transaction appends its COMMIT record and waits in Flush until the record is on
+ * disk. The flush thread swaps the log buffer with the flush buffer and writes and syncs everything appended so far in
+ * one go, so all transactions that committed while the previous write was in flight share one fsync. Commit
+ * throughput grows with the number of concurrent transactions instead of being capped by the fsync rate.
+ *
+ * Appends take no latch. The next LSN and the end of the log buffer are one atomic word: an append reserves its LSN
+ * together with its bytes of the buffer in a single compare-and-swap, serializes its record into them in parallel with
+ * other appends, and adds its size to the filled byte count. To swap the buffers, the flusher seals the word so no
+ * more appends get in, and waits only until the bytes reserved so far are all filled. LSN order is buffer order, so
+ * the log file stays sorted by LSN.
  */
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+      : reservation_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
     flush_buffer_ = new char[LOG_BUFFER_SIZE];
   }
@@ -46,27 +59,55 @@ class LogManager {
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /**
+   * Wait until the log is on disk up to and including lsn. Without a flush thread, the caller writes the log itself.
+   * @param lsn the log record that must be persistent, INVALID_LSN for every record appended so far. LSNs that were
+   * never handed out (e.g. the LSN field of a page that is not a table page) are clamped to the last appended record.
+   */
+  void Flush(lsn_t lsn = INVALID_LSN);
+
+  inline lsn_t GetNextLSN() { return ReservedLSN(reservation_.load()); }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
-
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
+  /**
+   * Swap the buffers and write out what was appended, with latch_ held through lock. Waits for a write that is
+   * already in flight first, since it still uses the flush buffer.
+   */
+  void FlushBuffer(std::unique_lock<std::mutex> *lock);
+
+  /** Set in the reservation word while the buffers are being swapped; appends have to wait. */
+  static constexpr uint64_t SEALED = uint64_t{1} << 31;
+  static lsn_t ReservedLSN(uint64_t reservation) { return static_cast<lsn_t>(reservation >> 32); }
+  static int ReservedBytes(uint64_t reservation) { return static_cast<int>(reservation & (SEALED - 1)); }
+  static uint64_t Reservation(lsn_t lsn, int bytes) { return static_cast<uint64_t>(lsn) << 32 | bytes; }
+
+  /** The next log sequence number in the high half, the bytes of log_buffer_ handed out in the low half. */
+  std::atomic<uint64_t> reservation_;
+  /** Bytes of log_buffer_ whose records are completely serialized. */
+  std::atomic<int> filled_{0};
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
+  /** Only swapped while the reservation word is sealed and every reservation is filled. */
   char *log_buffer_;
   char *flush_buffer_;
 
+  /** Serializes the buffer swaps and protects the flags below. Appends only take it when the buffer is full. */
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
+  /** Wakes the flush thread: a commit waits, the log buffer is full, or the thread has to stop. */
   std::condition_variable cv_;
+  /** Signalled whenever the buffers are swapped or a write completes; Flush and appends to a full buffer wait on it. */
+  std::condition_variable persist_cv_;
+  bool flush_requested_{false};
+  /** True while the flush buffer is being written. */
+  bool flushing_{false};
+  bool stop_flush_thread_{false};
 
   DiskManager *disk_manager_ __attribute__((__unused__));
 };
@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+class AsyncIOEngine;
+
+/** How an AsyncDiskManager gets its page I/Os done. */
+enum class AsyncIOBackend {
+  /** Requests go through an io_uring submission queue and are reaped by one completion thread. */
+  IO_URING,
+  /** Requests are queued for a pool of threads that each run one blocking pread/pwrite at a time. */
+  THREAD_POOL,
+};
+
+/**
+ * AsyncDiskManager is a DiskManager that can also read and write pages asynchronously. Every request returns a future
+ * that completes with the I/O, so a caller can keep up to queue_depth page I/Os in flight instead of the single one
+ * the DiskManager stream allows.
+ *
+ * The asynchronous I/Os use their own descriptor of the database file and do not take the DiskManager's stream latch.
+ * The caller must not issue two I/Os on the same page concurrently, and must keep page_data alive and unchanged until
+ * the future is ready. Allocation, the free page map and the log stay with DiskManager.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /** Default number of page I/Os in flight at once. */
+  static constexpr size_t DEFAULT_QUEUE_DEPTH = 64;
+
+  /**
+   * Creates a new asynchronous disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param queue_depth most page I/Os in flight at once, further requests wait for a slot
+   * @param prefer_io_uring use io_uring if the kernel supports it; otherwise, or if false, use a thread pool
+   */
+  explicit AsyncDiskManager(const std::string &db_file, size_t queue_depth = DEFAULT_QUEUE_DEPTH,
+                            bool prefer_io_uring = true);
+
+  /** Waits for the outstanding I/Os and shuts down. */
+  ~AsyncDiskManager() override;
+
+  DISALLOW_COPY_AND_MOVE(AsyncDiskManager);
+
+  /** Wait for the outstanding I/Os, stop the I/O engine and close all the file resources. */
+  void ShutDown() override;
+
+  /**
+   * Read a page from the database file in the background. Reads past the end of the file fill page_data with zeros.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, must stay valid until the future is ready
+   * @return a future that is true once page_data holds the page, false on an I/O error
+   */
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+
+  /**
+   * Write a page to the database file in the background.
+   * @param page_id id of the page
+   * @param page_data raw page data, must stay valid and unchanged until the future is ready
+   * @return a future that is true once the whole page is written, false on an I/O error
+   */
+  std::future<bool> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  /** Block until every I/O submitted so far has completed. */
+  void Drain();
+
+  /** @return the backend the I/Os actually go through */
+  AsyncIOBackend GetBackend() const { return backend_; }
+
+  /** @return most page I/Os in flight at once */
+  size_t GetQueueDepth() const { return queue_depth_; }
+
+ private:
+  /** Descriptor of the database file used by the asynchronous I/Os. */
+  int fd_;
+  const size_t queue_depth_;
+  AsyncIOBackend backend_;
+  std::unique_ptr<AsyncIOEngine> engine_;
+};
+
+}  // namespace bustub
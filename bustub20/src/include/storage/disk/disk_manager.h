@@ -13,14 +13,51 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <fstream>
 #include <future>  // NOLINT
+#include <mutex>   // NOLINT
+#include <set>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "common/rwlatch.h"
 
 namespace bustub {
 
+/** How DiskManager reads and writes pages of the database file. */
+enum class DiskIOMode {
+  /** Seek and read/write on one std::fstream, serialized by a latch. */
+  STREAM,
+  /** pread/pwrite on a raw file descriptor: no shared file position, so no latch and concurrent I/Os. */
+  POSITIONAL,
+  /** Like POSITIONAL, but opened with O_DIRECT to bypass the page cache, falling back to POSITIONAL if not supported. */
+  DIRECT,
+  /**
+   * Like POSITIONAL, but pages are LZ4-compressed into variable-size slots of the db file, found through a page map
+   * next to it. Saves disk space and bandwidth for CPU; a database written this way must be reopened this way.
+   */
+  COMPRESSED,
+  /**
+   * Read-only: the db file is mapped into memory and pages are served straight from the mapping, which a buffer pool
+   * hands out without copying. Writes are refused and the db file and the files next to it are never modified.
+   */
+  MMAP_READ_ONLY,
+};
+
+/** Access pattern hints for a memory-mapped database, see DiskManager::AdviseMapped. */
+enum class AccessPattern {
+  /** Default read-ahead. */
+  NORMAL,
+  /** Pages will be read in order: read ahead aggressively and drop pages soon after they were read. */
+  SEQUENTIAL,
+  /** Pages will be read in no particular order: no read-ahead. */
+  RANDOM,
+  /** Pages will be read soon: start reading them in the background. */
+  WILLNEED,
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
@@ -30,15 +67,19 @@ class DiskManager {
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param io_mode how pages are read and written, see DiskIOMode
+   * @param page_checksums stamp a CRC-32C on every written page and verify it on every read. The checksums live in a
+   * file next to the db file; opening a database without checksums drops that file, since it would go stale.
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, DiskIOMode io_mode = DiskIOMode::STREAM,
+                       bool page_checksums = false);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() = default;
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
@@ -55,7 +96,14 @@ class DiskManager {
   void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Read a batch of pages from the database file. Pages with consecutive ids are fetched with one read each.
+   * @param page_ids ids of the pages, in any order
+   * @param[out] page_data one output buffer per page id
+   */
+  void ReadPages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &page_data);
+
+  /**
+   * Flush the entire log buffer into disk, and sync it: the log is durable when this returns.
    * @param log_data raw log data
    * @param size size of log entry
    */
@@ -71,17 +119,38 @@ class DiskManager {
   bool ReadLog(char *log_data, int size, int offset);
 
   /**
-   * Allocate a page on disk.
+   * Allocate a page on disk, reusing the lowest deallocated page id if there is one.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
   /**
-   * Deallocate a page on disk.
+   * Reuse a deallocated page id from one residue class, for buffer pools that hand out their own page ids with a
+   * stride (e.g. every instance of a parallel buffer pool owns the ids with page_id % num_instances == instance_index).
+   * @param stride number of residue classes
+   * @param offset residue class to reuse an id from
+   * @return the lowest deallocated page id with page_id % stride == offset, INVALID_PAGE_ID if there is none
+   */
+  page_id_t ReuseFreePage(uint32_t stride, uint32_t offset);
+
+  /**
+   * Record a fresh page id that a buffer pool handed out itself instead of calling AllocatePage, so that
+   * DeallocatePage accepts it and AllocatePage never returns it.
+   * @param page_id the allocated page id
+   */
+  void MarkPageAllocated(page_id_t page_id);
+
+  /**
+   * Deallocate a page on disk. The id is recorded in the free page map and handed out again by AllocatePage or
+   * ReuseFreePage, so the database file does not grow while pages get dropped and created. Ids that were never
+   * allocated or written are ignored, they would otherwise be handed out twice.
    * @param page_id id of the page to deallocate
    */
   void DeallocatePage(page_id_t page_id);
 
+  /** @return the number of deallocated page ids waiting to be reused */
+  size_t GetNumFreePages();
+
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
 
@@ -91,6 +160,49 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return whether pages are checksummed */
+  bool HasPageChecksums() const { return page_checksums_; }
+
+  /**
+   * Check page data against the checksum stamped when the page was last written. ReadPage and ReadPages call this on
+   * every page they read; a mismatch means a torn or corrupted write, or a short read.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   * @return false on a mismatch, true if the checksum matches or the page has none
+   */
+  bool VerifyPage(page_id_t page_id, const char *page_data);
+
+  /** @return the number of pages read with a checksum mismatch */
+  int GetNumChecksumFailures() const { return num_checksum_failures_; }
+
+  /** @return how pages are actually read and written, DIRECT becomes POSITIONAL if the file system lacks O_DIRECT */
+  DiskIOMode GetIOMode() const { return io_mode_; }
+
+  /** @return the number of bytes of the db file taken by page slots in COMPRESSED mode, free slots included */
+  int64_t GetCompressedFileSize();
+
+  /**
+   * In MMAP_READ_ONLY mode, the page in the mapping of the db file. The memory is read-only: writing to it crashes.
+   * @param page_id id of the page
+   * @return the page data, nullptr if the page lies past the end of the file as it was when the disk manager opened it
+   */
+  const char *GetMappedPage(page_id_t page_id) const {
+    return page_id >= 0 && static_cast<size_t>(page_id) < num_mapped_pages_ ? mapped_data_ + static_cast<size_t>(page_id) * PAGE_SIZE
+                                                                           : nullptr;
+  }
+
+  /** @return the number of pages of the mapping in MMAP_READ_ONLY mode, 0 in other modes */
+  size_t GetNumMappedPages() const { return num_mapped_pages_; }
+
+  /**
+   * Tell the OS how the pages of the mapping will be read (madvise). Only valid in MMAP_READ_ONLY mode.
+   * @param pattern access pattern of the pages
+   * @param first_page first page the hint applies to
+   * @param num_pages number of pages the hint applies to, 0 for all pages from first_page on
+   * @return false if there is no mapping or the OS rejected the hint
+   */
+  bool AdviseMapped(AccessPattern pattern, page_id_t first_page = 0, size_t num_pages = 0);
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -102,15 +214,90 @@ class DiskManager {
 
  private:
   int GetFileSize(const std::string &file_name);
+  /** Read one page through the db file stream. */
+  void ReadStream(page_id_t page_id, char *page_data);
+  /** Open the checksum file and load the checksums of an existing database. */
+  void OpenChecksums(bool db_file_exists);
+  /** Stamp the checksum of a page that was just written. */
+  void StampPage(page_id_t page_id, const char *page_data);
+  /** Open the db file descriptor for POSITIONAL or DIRECT mode. */
+  void OpenPositional();
+  /**
+   * Read consecutive pages at page_id with one preadv, zero-filling whatever lies past the end of the file. In DIRECT
+   * mode, buffers that are not page aligned go through an aligned bounce buffer.
+   */
+  void ReadPositional(page_id_t page_id, const std::vector<char *> &page_data);
+  /** Open the page map for COMPRESSED mode and rebuild the free slots of an existing database. */
+  void OpenPageMap(bool db_file_exists);
+  /** Compress a page into its slot, moving it to a slot of another size if it no longer fits. */
+  void WriteCompressed(page_id_t page_id, const char *page_data);
+  /** Read a page from its slot and decompress it, zero-filling a page that was never written. */
+  void ReadCompressed(page_id_t page_id, char *page_data);
+  /** Take a free slot of num_sectors sectors, splitting a larger one or extending the file, with slots_latch_ held. */
+  uint32_t TakeSlot(uint32_t num_sectors);
+  /** Record the slot of a page in memory and in the page map, with slots_latch_ held. */
+  void SetPageSlot(page_id_t page_id, uint32_t sector, uint16_t size);
+  /** Map the db file read-only for MMAP_READ_ONLY mode. */
+  void OpenMapped();
+  /** Load the free page map of an existing database file. */
+  void LoadFreePageMap();
+  /** Persist whether page_id is free, by rewriting the byte of the free page map that holds its bit. */
+  void WriteFreePageBit(page_id_t page_id);
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
+  // second descriptor of the log file, only to fdatasync what log_io_ wrote
+  int log_fd_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
+  // serializes page reads and writes: several buffer pool instances and their background threads share one file
+  std::mutex db_io_latch_;
+  DiskIOMode io_mode_;
+  // db file descriptor in POSITIONAL and DIRECT mode, -1 in STREAM mode
+  int db_fd_;
+  // size of the db file in POSITIONAL and DIRECT mode, kept up to date by WritePage instead of a stat per read
+  std::atomic<int64_t> db_file_size_;
+  // page checksums: one CRC-32C per page id in memory and in a file next to the db file, NO_CHECKSUM if none yet
+  static constexpr uint32_t NO_CHECKSUM = 0;
+  bool page_checksums_;
+  std::string checksum_name_;
+  int checksum_fd_;
+  std::vector<uint32_t> checksums_;
+  ReaderWriterLatch checksums_latch_;
+  std::atomic<int> num_checksum_failures_;
+  // COMPRESSED mode: where every page id lives in the db file, in memory and in a page map file next to the db file
+  struct PageSlot {
+    // first sector of the slot
+    uint32_t sector_;
+    // bytes stored in the slot: 0 if the page was never written, PAGE_SIZE if it did not compress
+    uint16_t size_;
+    uint16_t reserved_;
+  };
+  // slots are whole sectors, so a page takes 1 to SECTORS_PER_PAGE sectors
+  static constexpr uint32_t SECTOR_SIZE = 512;
+  static constexpr uint32_t SECTORS_PER_PAGE = PAGE_SIZE / SECTOR_SIZE;
+  std::string map_name_;
+  int map_fd_;
+  std::vector<PageSlot> page_slots_;
+  // first sectors of the free slots, by slot size in sectors
+  std::vector<uint32_t> free_slots_[SECTORS_PER_PAGE + 1];
+  // end of the last slot, in sectors
+  uint32_t num_sectors_;
+  // covers slot bookkeeping only, the page I/O runs outside of it
+  std::mutex slots_latch_;
+  // MMAP_READ_ONLY mode: read-only mapping of the whole db file
+  char *mapped_data_;
+  size_t num_mapped_pages_;
   std::atomic<page_id_t> next_page_id_;
+  // free page map next to the db file, one bit per page id, set while the page is deallocated
+  std::fstream fsm_io_;
+  std::string fsm_name_;
+  // deallocated page ids in memory, lowest first so reused pages keep the file compact
+  std::set<page_id_t> free_pages_;
+  std::mutex free_pages_latch_;
   int num_flushes_;
-  int num_writes_;
+  std::atomic<int> num_writes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
 };
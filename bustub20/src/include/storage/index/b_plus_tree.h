@@ -34,11 +34,22 @@ enum class BPlusTreeConcurrentControlMode {
   Lookup
 };
 
+//一次操作中沿路径锁住的page，用guard持有：释放guard就是解锁+unpin
 class BPlusTreeConcurrentControl{
 public:
-  void lock_one(BPlusTreePage*);
-  // void wlock_one(BPlusTreePage*);
+  //fetch并锁住page，guard留在这里，释放之前返回的page一直有效
+  //@return nullptr if the page could not be fetched
+  Page* lock_one(page_id_t page_id);
+  //前面已经锁住、还没放掉的page
+  //@return nullptr if the page is not locked here
+  Page* locked_page(page_id_t page_id);
   void if_safe_then_free_pre();
+  //还锁着的这个page被改过，unpin时要标脏
+  void mark_dirty(page_id_t page_id);
+  //合并掉的page：它可能还被锁着，等所有guard放掉之后再DeletePage
+  void delete_after_release(page_id_t page_id);
+  //解锁、unpin路径上所有page，再删除等着删的page
+  void release_all();
 
   BPlusTreeConcurrentControl(BPlusTreeConcurrentControl const&) = delete;
   BPlusTreeConcurrentControl& operator=(BPlusTreeConcurrentControl const&) = delete;
@@ -51,9 +62,7 @@ public:
   }
   BPlusTreeConcurrentControl()=default;
   ~BPlusTreeConcurrentControl(){
-    for(auto &v:locked_pages_){
-      unlock_and_unpin_page(v);
-    }
+    release_all();
   }
   void init(BPlusTreeConcurrentControlMode mode,
     BufferPoolManager*bpman_ref){
@@ -62,13 +71,7 @@ public:
   }
 private:
   void free_pre();
-  void unlock_and_unpin_page(BPlusTreePage*page){
-    if(read_mode()){
-      page->RUnlock();
-    }else{
-      page->WUnlock();
-    }
-  }
+  BPlusTreePage* last_locked();
   bool read_mode(){
     if(mode_==BPlusTreeConcurrentControlMode::Lookup){
       return true;
@@ -77,7 +80,10 @@ private:
   }
   BPlusTreeConcurrentControlMode mode_;
    BufferPoolManager*bpman_ref_;
-  std::list<BPlusTreePage*> locked_pages_;//is read, page
+  //查找只加读锁，插入删除加写锁，两种不会同时用
+  std::list<ReadPageGuard> read_guards_;
+  std::list<WritePageGuard> write_guards_;
+  std::vector<page_id_t> deleted_pages_;
 };
 
 /**
@@ -139,9 +145,13 @@ class BPlusTree {
  
  private:
   bool StartNewTree(const KeyType &key, const ValueType &value);
+
+  //乐观下降：内部节点只pin不加锁，靠版本号校验读到的东西，找到叶子后才加读锁
+  //@return false if a concurrent writer got in the way, the descent has to restart
+  bool FindLeafOptimistic(const KeyType &key, ReadPageGuard *leaf);
   
   
-  Page* _NewInternalPage(page_id_t parent_id);
+  BasicPageGuard _NewInternalPage(page_id_t parent_id);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, BPlusTreeConcurrentControl&conccur,Transaction *transaction = nullptr);
 
@@ -149,27 +159,32 @@ class BPlusTree {
     BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
     BPlusTreeConcurrentControl& concurr,Transaction *transaction = nullptr);
 
+  //新page由new_guard持有，调用者用完之后才unpin
   template <typename N>
-  N *Split(N *node);
+  N *Split(N *node, BasicPageGuard *new_guard);
 
   template <typename N>
   bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
 
   bool CoalesceEdgeHandle(InternalPage** parent,
     KeyType old_parent_first_key,
+    BPlusTreeConcurrentControl& concurr,
     Transaction *transaction);
   bool CoalesceCheckParentRootExpire(
     BPlusTreePage* one_childpage,
-    InternalPage* parent);
+    InternalPage* parent,
+    BPlusTreeConcurrentControl& concurr);
   // template <typename N>
   bool Coalesce(LeafPage **neighbor_node, LeafPage **node,
      BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
                 int index,bool sib_on_right,
+                BPlusTreeConcurrentControl& concurr,
                  Transaction *transaction = nullptr
                 );
   bool Coalesce(InternalPage **neighbor_node, InternalPage **node,
      BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
                 int index,bool sib_on_right,
+                BPlusTreeConcurrentControl& concurr,
                  Transaction *transaction = nullptr
                 );
 
@@ -196,6 +211,8 @@ class BPlusTree {
   int leaf_max_size_;
   int internal_max_size_;
   std::mutex big_mu_;
+  //乐观下降连续失败这么多次，就退回读锁蟹行
+  static constexpr int OPTIMISTIC_RESTARTS = 8;
   // IndexPageType root_page_type;
 };
 
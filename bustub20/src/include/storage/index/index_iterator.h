@@ -22,7 +22,7 @@ class BPlusTreeConcurrentControl;
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 //用于遍历b+树
-// 注：会持有page，销毁时应该unpin
+// 注：持有的page在concurr的guard里，随concurr一起释放
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
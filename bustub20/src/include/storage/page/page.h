@@ -12,9 +12,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <thread>  // NOLINT
 
+#include "buffer/frame_descriptor_table.h"
 #include "common/config.h"
 #include "common/rwlatch.h"
 
@@ -24,14 +28,20 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * Neither the page data nor the book-keeping is part of Page: the data lives in the FrameArena of the buffer pool and
+ * the book-keeping in its FrameDescriptorTable, which both bind each Page to its frame.
  */
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
+  friend class BufferPoolManagerInstance;
+  friend class FrameArena;
+  friend class FrameDescriptorTable;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. The page has no data or book-keeping until a FrameArena and a FrameDescriptorTable bind it. */
+  Page() = default;
 
   /** Default destructor. */
   ~Page() = default;
@@ -40,19 +50,27 @@ class Page {
   inline char *GetData() { return data_; }
 
   /** @return the page id of this page */
-  inline page_id_t GetPageId() { return page_id_; }
+  inline page_id_t GetPageId() { return descriptors_->GetPageId(frame_id_); }
 
   /** @return the pin count of this page */
-  inline int GetPinCount() { return pin_count_; }
+  inline int GetPinCount() { return descriptors_->GetPinCount(frame_id_); }
 
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
-  inline bool IsDirty() { return is_dirty_; }
+  inline bool IsDirty() { return descriptors_->IsDirty(frame_id_); }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  /** Acquire the page write latch. Makes the version odd until WUnlatch, failing concurrent optimistic reads. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // The writes to the page must not become visible before the odd version.
+    std::atomic_thread_fence(std::memory_order_release);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -60,6 +78,30 @@ class Page {
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /**
+   * Start an optimistic read: wait until no writer holds the latch and return the current version. The page must stay
+   * pinned; whatever is read from it is only meaningful if ValidateVersion succeeds afterwards. Unlike RLatch, this
+   * does not write to shared memory.
+   * @return the version to pass to ValidateVersion
+   */
+  inline uint64_t ReadVersion() {
+    uint64_t version = version_.load(std::memory_order_acquire);
+    while ((version & 1) != 0) {
+      std::this_thread::yield();
+      version = version_.load(std::memory_order_acquire);
+    }
+    return version;
+  }
+
+  /**
+   * Finish an optimistic read.
+   * @return true if no writer latched the page since ReadVersion returned version, false if the read must restart
+   */
+  inline bool ValidateVersion(uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -78,16 +120,16 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
-  /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
-  /** Page latch. */
-  ReaderWriterLatch rwlatch_;
+  /** The actual data that is stored within a page, PAGE_SIZE bytes owned by the buffer pool's FrameArena. */
+  char *data_ = nullptr;
+  /** Page id, pin count and dirty flag of this page, stored in the buffer pool's FrameDescriptorTable. */
+  FrameDescriptorTable *descriptors_ = nullptr;
+  /** The frame this page is bound to, its index in the FrameDescriptorTable. */
+  frame_id_t frame_id_ = -1;
+  /** Page latch. Latched sections on pages are short, so it spins before it parks. */
+  HybridReaderWriterLatch rwlatch_;
+  /** Version for optimistic reads, odd while the write latch is held. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
@@ -12,6 +12,8 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,12 +24,95 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  enable_logging = true;
+  stop_flush_thread_ = false;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (!stop_flush_thread_) {
+      cv_.wait_for(lock, log_timeout, [this] { return stop_flush_thread_ || flush_requested_; });
+      // everything that piled up while the last write was in flight goes out in this one
+      flush_requested_ = false;
+      FlushBuffer(&lock);
+    }
+    FlushBuffer(&lock);
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  std::thread *flush_thread;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    flush_thread = flush_thread_;
+    stop_flush_thread_ = true;
+  }
+  if (flush_thread == nullptr) {
+    return;
+  }
+  cv_.notify_one();
+  flush_thread->join();
+  delete flush_thread;
+  std::lock_guard<std::mutex> guard(latch_);
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
+
+/*
+ * Wait until lsn is persistent. The flush thread is woken right away instead of at its timeout, and one write
+ * covers every transaction waiting at that point
+ */
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  lsn_t last_lsn = ReservedLSN(reservation_.load()) - 1;
+  lsn = lsn == INVALID_LSN ? last_lsn : std::min(lsn, last_lsn);
+  if (flush_thread_ == nullptr || stop_flush_thread_) {
+    while (persistent_lsn_ < lsn) {
+      FlushBuffer(&lock);
+    }
+    return;
+  }
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  flush_requested_ = true;
+  cv_.notify_one();
+  persist_cv_.wait(lock, [this, lsn] { return persistent_lsn_ >= lsn; });
+}
+
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> *lock) {
+  persist_cv_.wait(*lock, [this] { return !flushing_; });
+  // seal the buffer, appenders that come later wait for the fresh one
+  uint64_t reservation = reservation_.fetch_or(SEALED);
+  int size = ReservedBytes(reservation);
+  if (size == 0) {
+    reservation_.store(reservation);
+    return;
+  }
+  // appenders that got their bytes before the seal are still copying their records in
+  while (filled_.load(std::memory_order_acquire) != size) {
+    std::this_thread::yield();
+  }
+  std::swap(log_buffer_, flush_buffer_);
+  lsn_t last_lsn = ReservedLSN(reservation) - 1;
+  filled_.store(0, std::memory_order_relaxed);
+  reservation_.store(Reservation(ReservedLSN(reservation), 0), std::memory_order_release);
+  flushing_ = true;
+  // appenders waiting for space can go on in the fresh buffer
+  persist_cv_.notify_all();
+  lock->unlock();
+  disk_manager_->WriteLog(flush_buffer_, size);
+  lock->lock();
+  persistent_lsn_ = last_lsn;
+  flushing_ = false;
+  persist_cv_.notify_all();
+}
 
 /*
  * append a log record into log buffer
@@ -35,20 +120,72 @@ void LogManager::StopFlushThread() {}
  * @return: lsn that is assigned to this log record
  *
  *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * The LSN and the bytes of the log buffer are reserved together in one compare-and-swap, so LSN order is log order;
+ * the record is then serialized without holding any latch, concurrently with other appenders
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  int size = log_record->size_;
+  uint64_t reservation = reservation_.load(std::memory_order_acquire);
+  while (true) {
+    if ((reservation & SEALED) == 0 && ReservedBytes(reservation) + size <= LOG_BUFFER_SIZE) {
+      uint64_t next = Reservation(ReservedLSN(reservation) + 1, ReservedBytes(reservation) + size);
+      if (reservation_.compare_exchange_weak(reservation, next, std::memory_order_acquire)) {
+        break;
+      }
+      continue;
+    }
+    // the buffer is full or being swapped: take the latch, the swap holds it
+    std::unique_lock<std::mutex> lock(latch_);
+    reservation = reservation_.load(std::memory_order_acquire);
+    if (ReservedBytes(reservation) + size > LOG_BUFFER_SIZE) {
+      // have the buffer swapped, by the flush thread if there is one
+      if (flush_thread_ == nullptr || stop_flush_thread_) {
+        FlushBuffer(&lock);
+      } else {
+        flush_requested_ = true;
+        cv_.notify_one();
+        persist_cv_.wait(lock);
+      }
+      reservation = reservation_.load(std::memory_order_acquire);
+    }
+  }
+  log_record->lsn_ = ReservedLSN(reservation);
+  char *data = log_buffer_ + ReservedBytes(reservation);
+  // the header fields come first in LogRecord
+  memcpy(data, log_record, LogRecord::HEADER_SIZE);
+  int pos = LogRecord::HEADER_SIZE;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(data + pos, &log_record->insert_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->insert_tuple_.SerializeTo(data + pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(data + pos, &log_record->delete_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->delete_tuple_.SerializeTo(data + pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(data + pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(data + pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(data + pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(data + pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(data + pos, &log_record->page_id_, sizeof(page_id_t));
+      break;
+    default:
+      break;
+  }
+  lsn_t lsn = log_record->lsn_;
+  // the flusher may write the buffer out once this is added, log_record is the caller's again
+  filled_.fetch_add(size, std::memory_order_release);
+  return lsn;
+}
 
 }  // namespace bustub
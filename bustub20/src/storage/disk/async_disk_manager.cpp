@@ -0,0 +1,460 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+// IORING_OP_READ/WRITE and the opcode probe came with Linux 5.6, older headers get the thread pool only
+#ifdef IO_URING_OP_SUPPORTED
+#define BUSTUB_HAVE_IO_URING
+#endif
+#endif
+
+namespace bustub {
+
+/** One page I/O in flight. */
+struct AsyncIORequest {
+  bool is_write_;
+  page_id_t page_id_;
+  char *page_data_;
+  std::promise<bool> done_;
+  /** Bytes of the page transferred so far, an engine that gets a short transfer continues from here. */
+  ssize_t transferred_{0};
+};
+
+/**
+ * Base of the I/O engines: bounds the number of requests in flight and completes them. Submit takes a slot, the
+ * engine starts the request, and whatever thread sees it finish calls Complete, which releases the slot.
+ */
+class AsyncIOEngine {
+ public:
+  AsyncIOEngine(int fd, size_t queue_depth) : fd_(fd), queue_depth_(queue_depth) {}
+  virtual ~AsyncIOEngine() = default;
+
+  DISALLOW_COPY_AND_MOVE(AsyncIOEngine);
+
+  std::future<bool> Submit(bool is_write, page_id_t page_id, char *page_data) {
+    auto *request = new AsyncIORequest{is_write, page_id, page_data, std::promise<bool>()};
+    auto future = request->done_.get_future();
+    {
+      std::unique_lock<std::mutex> lock(slots_latch_);
+      slots_cv_.wait(lock, [this] { return in_flight_ < queue_depth_; });
+      in_flight_++;
+    }
+    Start(request);
+    return future;
+  }
+
+  void Drain() {
+    std::unique_lock<std::mutex> lock(slots_latch_);
+    slots_cv_.wait(lock, [this] { return in_flight_ == 0; });
+  }
+
+  /** Stop the engine's threads. Called once, after Drain. */
+  virtual void Stop() = 0;
+
+ protected:
+  /** Begin the I/O of request; the engine owns it until it calls Complete. */
+  virtual void Start(AsyncIORequest *request) = 0;
+
+  /**
+   * Finish a request.
+   * @param result bytes transferred, short only at the end of the file, or -errno
+   */
+  void Complete(AsyncIORequest *request, ssize_t result) {
+    bool ok;
+    if (request->is_write_) {
+      ok = result == PAGE_SIZE;
+      if (!ok) {
+        LOG_DEBUG("I/O error while writing page %d: %zd", request->page_id_, result);
+      }
+    } else {
+      ok = result >= 0;
+      if (!ok) {
+        LOG_DEBUG("I/O error while reading page %d: %zd", request->page_id_, result);
+      } else if (result < PAGE_SIZE) {
+        // the file ends inside or before the page, like DiskManager::ReadPage the rest reads as zeros
+        memset(request->page_data_ + result, 0, PAGE_SIZE - result);
+      }
+    }
+    request->done_.set_value(ok);
+    delete request;
+    {
+      std::lock_guard<std::mutex> guard(slots_latch_);
+      in_flight_--;
+    }
+    slots_cv_.notify_all();
+  }
+
+  static off_t PageOffset(page_id_t page_id) { return static_cast<off_t>(page_id) * PAGE_SIZE; }
+
+  const int fd_;
+  const size_t queue_depth_;
+
+ private:
+  std::mutex slots_latch_;
+  std::condition_variable slots_cv_;
+  size_t in_flight_ = 0;
+};
+
+/** Fallback engine: a pool of threads running blocking pread/pwrite, so up to one I/O per thread is in flight. */
+class ThreadPoolIOEngine : public AsyncIOEngine {
+ public:
+  /** Most threads of the pool; deeper queues wait in the request queue. */
+  static constexpr size_t MAX_THREADS = 16;
+
+  ThreadPoolIOEngine(int fd, size_t queue_depth) : AsyncIOEngine(fd, queue_depth) {
+    size_t num_threads = std::min(queue_depth, MAX_THREADS);
+    for (size_t i = 0; i < num_threads; i++) {
+      workers_.emplace_back(&ThreadPoolIOEngine::RunWorker, this);
+    }
+  }
+
+  ~ThreadPoolIOEngine() override = default;
+
+  DISALLOW_COPY_AND_MOVE(ThreadPoolIOEngine);
+
+  void Stop() override {
+    {
+      std::lock_guard<std::mutex> guard(queue_latch_);
+      stop_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+ protected:
+  void Start(AsyncIORequest *request) override {
+    {
+      std::lock_guard<std::mutex> guard(queue_latch_);
+      queue_.push_back(request);
+    }
+    queue_cv_.notify_one();
+  }
+
+ private:
+  void RunWorker() {
+    while (true) {
+      AsyncIORequest *request;
+      {
+        std::unique_lock<std::mutex> lock(queue_latch_);
+        queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        request = queue_.front();
+        queue_.pop_front();
+      }
+      Complete(request, Transfer(request));
+    }
+  }
+
+  /** @return bytes transferred, short only at the end of the file, or -errno */
+  ssize_t Transfer(AsyncIORequest *request) {
+    ssize_t done = 0;
+    while (done < PAGE_SIZE) {
+      off_t offset = PageOffset(request->page_id_) + done;
+      ssize_t n = request->is_write_ ? pwrite(fd_, request->page_data_ + done, PAGE_SIZE - done, offset)
+                                     : pread(fd_, request->page_data_ + done, PAGE_SIZE - done, offset);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        return -errno;
+      }
+      if (n == 0) {
+        break;
+      }
+      done += n;
+    }
+    return done;
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex queue_latch_;
+  std::condition_variable queue_cv_;
+  std::deque<AsyncIORequest *> queue_;
+  bool stop_ = false;
+};
+
+#ifdef BUSTUB_HAVE_IO_URING
+
+/**
+ * io_uring engine: submitters fill submission queue entries under a latch and enter the kernel once per request, one
+ * completion thread waits for completion queue entries and completes the requests. Talks to the kernel through the
+ * raw system calls, so it needs no liburing.
+ */
+class IoUringIOEngine : public AsyncIOEngine {
+ public:
+  /** @return the engine, or nullptr if the kernel has no io_uring or no IORING_OP_READ/WRITE */
+  static std::unique_ptr<IoUringIOEngine> Create(int fd, size_t queue_depth) {
+    std::unique_ptr<IoUringIOEngine> engine(new IoUringIOEngine(fd, queue_depth));
+    if (!engine->Setup()) {
+      return nullptr;
+    }
+    engine->completer_ = std::thread(&IoUringIOEngine::RunCompleter, engine.get());
+    return engine;
+  }
+
+  ~IoUringIOEngine() override {
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+      close(ring_fd_);
+    }
+  }
+
+  DISALLOW_COPY_AND_MOVE(IoUringIOEngine);
+
+  void Stop() override {
+    // a NOP without request wakes the completion thread for the last time
+    Push(IORING_OP_NOP, nullptr);
+    completer_.join();
+  }
+
+ protected:
+  void Start(AsyncIORequest *request) override {
+    Push(request->is_write_ ? IORING_OP_WRITE : IORING_OP_READ, request);
+  }
+
+ private:
+  IoUringIOEngine(int fd, size_t queue_depth) : AsyncIOEngine(fd, queue_depth) {}
+
+  static int IoUringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+  }
+  static int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+  }
+  static int IoUringRegister(int ring_fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+  }
+
+  bool Setup() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    // the completion queue is twice as long, with at most queue_depth_ requests in flight it never overflows
+    ring_fd_ = IoUringSetup(static_cast<unsigned>(queue_depth_), &params);
+    if (ring_fd_ < 0) {
+      LOG_DEBUG("io_uring_setup failed: %s", strerror(errno));
+      return false;
+    }
+    if (!Supports(IORING_OP_READ) || !Supports(IORING_OP_WRITE)) {
+      LOG_DEBUG("io_uring does not support IORING_OP_READ/WRITE");
+      return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe *>(Map(sqes_size_, IORING_OFF_SQES));
+    if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes_ == nullptr) {
+      LOG_DEBUG("io_uring ring mmap failed: %s", strerror(errno));
+      return false;
+    }
+    auto *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    auto *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  bool Supports(uint8_t opcode) {
+    std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+    if (IoUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+      return false;
+    }
+    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+  }
+
+  void *Map(size_t size, off_t offset) {
+    void *ring = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return ring == MAP_FAILED ? nullptr : ring;
+  }
+
+  /** Queue one entry and hand it to the kernel. */
+  void Push(uint8_t opcode, AsyncIORequest *request) {
+    std::lock_guard<std::mutex> guard(sq_latch_);
+    // the kernel consumes entries inside io_uring_enter, so the slot at the tail is always free here
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    if (request != nullptr) {
+      sqe->fd = fd_;
+      sqe->addr = reinterpret_cast<uint64_t>(request->page_data_ + request->transferred_);
+      sqe->len = static_cast<uint32_t>(PAGE_SIZE - request->transferred_);
+      sqe->off = static_cast<uint64_t>(PageOffset(request->page_id_) + request->transferred_);
+    }
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    while (true) {
+      int submitted = IoUringEnter(ring_fd_, 1, 0, 0);
+      if (submitted == 1) {
+        return;
+      }
+      if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        // the entry is still queued and goes in with the next enter; nothing else can be done about it here
+        LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void RunCompleter() {
+    bool stopped = false;
+    while (!stopped) {
+      if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+      }
+      unsigned head = *cq_head_;
+      unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; head++) {
+        io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+        auto *request = reinterpret_cast<AsyncIORequest *>(cqe->user_data);
+        int res = cqe->res;
+        // the entry is consumed before a resubmission can add one
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        if (request == nullptr) {
+          stopped = true;
+        } else {
+          Continue(request, res);
+        }
+      }
+    }
+  }
+
+  /**
+   * Handle the completion of one submission of a request. Short transfers can happen anywhere in the file, like with
+   * pread/pwrite the rest is submitted again; only a read that transfers nothing has reached the end of the file.
+   */
+  void Continue(AsyncIORequest *request, int res) {
+    if (res == -EINTR || res == -EAGAIN) {
+      Push(request->is_write_ ? IORING_OP_WRITE : IORING_OP_READ, request);
+      return;
+    }
+    if (res <= 0) {
+      Complete(request, res < 0 ? res : request->transferred_);
+      return;
+    }
+    request->transferred_ += res;
+    if (request->transferred_ < PAGE_SIZE) {
+      Push(request->is_write_ ? IORING_OP_WRITE : IORING_OP_READ, request);
+      return;
+    }
+    Complete(request, request->transferred_);
+  }
+
+  int ring_fd_ = -1;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  size_t sqes_size_ = 0;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+  // serializes submitters on the submission queue tail
+  std::mutex sq_latch_;
+  std::thread completer_;
+};
+
+#endif
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, size_t queue_depth, bool prefer_io_uring)
+    : DiskManager(db_file), queue_depth_(std::max<size_t>(queue_depth, 1)), backend_(AsyncIOBackend::THREAD_POOL) {
+  // DiskManager has created the file already
+  fd_ = open(db_file.c_str(), O_RDWR);
+  if (fd_ < 0) {
+    throw Exception("can't open db file for asynchronous I/O");
+  }
+#ifdef BUSTUB_HAVE_IO_URING
+  if (prefer_io_uring) {
+    engine_ = IoUringIOEngine::Create(fd_, queue_depth_);
+    if (engine_ != nullptr) {
+      backend_ = AsyncIOBackend::IO_URING;
+    }
+  }
+#endif
+  if (engine_ == nullptr) {
+    engine_ = std::make_unique<ThreadPoolIOEngine>(fd_, queue_depth_);
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() { ShutDown(); }
+
+void AsyncDiskManager::ShutDown() {
+  if (engine_ != nullptr) {
+    engine_->Drain();
+    engine_->Stop();
+    engine_.reset();
+    close(fd_);
+    fd_ = -1;
+  }
+  DiskManager::ShutDown();
+}
+
+std::future<bool> AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  return engine_->Submit(false, page_id, page_data);
+}
+
+std::future<bool> AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  // only reads write into the buffer
+  return engine_->Submit(true, page_id, const_cast<char *>(page_data));
+}
+
+void AsyncDiskManager::Drain() { engine_->Drain(); }
+
+}  // namespace bustub
@@ -10,33 +10,65 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>  // NOLINT
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/util/crc32c.h"
+#include "common/util/lz4.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 static char *buffer_used;
 
+static_assert(PAGE_SIZE <= UINT16_MAX, "page slot sizes are 16 bits");
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, DiskIOMode io_mode, bool page_checksums)
+    : log_fd_(-1),
+      file_name_(db_file),
+      io_mode_(io_mode),
+      db_fd_(-1),
+      db_file_size_(0),
+      page_checksums_(page_checksums),
+      checksum_fd_(-1),
+      num_checksum_failures_(0),
+      map_fd_(-1),
+      num_sectors_(0),
+      mapped_data_(nullptr),
+      num_mapped_pages_(0),
+      next_page_id_(0),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
+  checksum_name_ = file_name_.substr(0, n) + ".crc";
+  map_name_ = file_name_.substr(0, n) + ".map";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -51,6 +83,30 @@ DiskManager::DiskManager(const std::string &db_file)
       throw Exception("can't open dblog file");
     }
   }
+  log_fd_ = open(log_name_.c_str(), O_WRONLY);
+
+  bool db_file_exists = GetFileSize(db_file) >= 0;
+  if (io_mode_ == DiskIOMode::MMAP_READ_ONLY && !db_file_exists) {
+    throw Exception("can't open db file");
+  }
+  if (db_file_exists) {
+    LoadFreePageMap();
+  } else {
+    // a free page map left behind by a removed database file does not belong to the new one
+    std::remove(fsm_name_.c_str());
+  }
+  OpenChecksums(db_file_exists);
+  OpenPageMap(db_file_exists);
+  if (io_mode_ == DiskIOMode::MMAP_READ_ONLY) {
+    OpenMapped();
+    buffer_used = nullptr;
+    return;
+  }
+  if (io_mode_ != DiskIOMode::STREAM) {
+    OpenPositional();
+    buffer_used = nullptr;
+    return;
+  }
 
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
   // directory or file does not exist
@@ -72,14 +128,79 @@ DiskManager::DiskManager(const std::string &db_file)
  * Close all file streams
  */
 void DiskManager::ShutDown() {
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, num_mapped_pages_ * PAGE_SIZE);
+    mapped_data_ = nullptr;
+    num_mapped_pages_ = 0;
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
+  if (checksum_fd_ >= 0) {
+    close(checksum_fd_);
+    checksum_fd_ = -1;
+  }
+  if (map_fd_ >= 0) {
+    close(map_fd_);
+    map_fd_ = -1;
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+    log_fd_ = -1;
+  }
   db_io_.close();
   log_io_.close();
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  fsm_io_.close();
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (io_mode_ == DiskIOMode::MMAP_READ_ONLY) {
+    LOG_WARN("page %d not written: the database is opened read-only", page_id);
+    return;
+  }
+  // a page in the file counts as allocated, the same as after a restart
+  MarkPageAllocated(page_id);
+  if (io_mode_ == DiskIOMode::COMPRESSED) {
+    num_writes_ += 1;
+    WriteCompressed(page_id, page_data);
+    StampPage(page_id, page_data);
+    return;
+  }
+  if (db_fd_ >= 0) {
+    int64_t offset = static_cast<int64_t>(page_id) * PAGE_SIZE;
+    num_writes_ += 1;
+    // O_DIRECT needs an aligned buffer
+    std::unique_ptr<char, decltype(&free)> bounce(nullptr, &free);
+    if (io_mode_ == DiskIOMode::DIRECT && reinterpret_cast<uintptr_t>(page_data) % PAGE_SIZE != 0) {
+      bounce.reset(static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE)));
+      memcpy(bounce.get(), page_data, PAGE_SIZE);
+      page_data = bounce.get();
+    }
+    ssize_t written = 0;
+    while (written < PAGE_SIZE) {
+      ssize_t n = pwrite(db_fd_, page_data + written, PAGE_SIZE - written, offset + written);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      // check for I/O error
+      if (n <= 0) {
+        LOG_DEBUG("I/O error while writing");
+        return;
+      }
+      written += n;
+    }
+    int64_t file_size = db_file_size_.load();
+    while (file_size < offset + PAGE_SIZE && !db_file_size_.compare_exchange_weak(file_size, offset + PAGE_SIZE)) {
+    }
+    StampPage(page_id, page_data);
+    return;
+  }
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
   size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
   // set write cursor to offset
   num_writes_ += 1;
@@ -92,12 +213,38 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   }
   // needs to flush to keep disk file in sync
   db_io_.flush();
+  StampPage(page_id, page_data);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (io_mode_ == DiskIOMode::MMAP_READ_ONLY) {
+    const char *mapped = GetMappedPage(page_id);
+    if (mapped == nullptr) {
+      LOG_DEBUG("I/O error reading past end of file");
+      memset(page_data, 0, PAGE_SIZE);
+    } else {
+      memcpy(page_data, mapped, PAGE_SIZE);
+    }
+  } else if (io_mode_ == DiskIOMode::COMPRESSED) {
+    ReadCompressed(page_id, page_data);
+  } else if (db_fd_ >= 0) {
+    ReadPositional(page_id, {page_data});
+  } else {
+    ReadStream(page_id, page_data);
+  }
+  if (page_checksums_) {
+    VerifyPage(page_id, page_data);
+  }
+}
+
+/**
+ * Read one page through the stream, zero-filling a short read
+ */
+void DiskManager::ReadStream(page_id_t page_id, char *page_data) {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
   int offset = page_id * PAGE_SIZE;
   // check if read beyond file length
   if (offset > GetFileSize(file_name_)) {
@@ -122,6 +269,80 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   }
 }
 
+/**
+ * Read a batch of pages, one seek + read per run of consecutive page ids
+ */
+void DiskManager::ReadPages(const std::vector<page_id_t> &page_ids, const std::vector<char *> &page_data) {
+  assert(page_ids.size() == page_data.size());
+  if (io_mode_ == DiskIOMode::COMPRESSED || io_mode_ == DiskIOMode::MMAP_READ_ONLY) {
+    // compressed pages with consecutive ids are not adjacent in the file, mapped pages need no I/O at all
+    for (size_t i = 0; i < page_ids.size(); i++) {
+      ReadPage(page_ids[i], page_data[i]);
+    }
+    return;
+  }
+  std::vector<size_t> order(page_ids.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return page_ids[a] < page_ids[b]; });
+
+  std::unique_lock<std::mutex> db_io_lock(db_io_latch_, std::defer_lock);
+  int file_size = 0;
+  if (db_fd_ < 0) {
+    db_io_lock.lock();
+    file_size = GetFileSize(file_name_);
+  }
+  std::vector<char> run_buffer;
+  size_t begin = 0;
+  while (begin < order.size()) {
+    size_t end = begin + 1;
+    while (end < order.size() && page_ids[order[end]] == page_ids[order[end - 1]] + 1) {
+      end++;
+    }
+    if (db_fd_ >= 0) {
+      // one preadv straight into the page buffers, no copy through run_buffer
+      std::vector<char *> run_data;
+      for (size_t i = begin; i < end; i++) {
+        run_data.push_back(page_data[order[i]]);
+      }
+      ReadPositional(page_ids[order[begin]], run_data);
+      begin = end;
+      continue;
+    }
+    int offset = page_ids[order[begin]] * PAGE_SIZE;
+    int run_size = static_cast<int>(end - begin) * PAGE_SIZE;
+    run_buffer.assign(run_size, 0);
+    // check if read beyond file length
+    if (offset > file_size) {
+      LOG_DEBUG("I/O error reading past end of file");
+    } else {
+      db_io_.seekp(offset);
+      db_io_.read(run_buffer.data(), run_size);
+      if (db_io_.bad()) {
+        LOG_DEBUG("I/O error while reading");
+        return;
+      }
+      // if file ends before the end of the run, the tail stays zeroed
+      if (db_io_.gcount() < run_size) {
+        db_io_.clear();
+      }
+    }
+    for (size_t i = begin; i < end; i++) {
+      memcpy(page_data[order[i]], run_buffer.data() + (i - begin) * PAGE_SIZE, PAGE_SIZE);
+    }
+    begin = end;
+  }
+  if (page_checksums_) {
+    if (db_io_lock.owns_lock()) {
+      db_io_lock.unlock();
+    }
+    for (size_t i = 0; i < page_ids.size(); i++) {
+      VerifyPage(page_ids[i], page_data[i]);
+    }
+  }
+}
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
@@ -153,6 +374,10 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
   // needs to flush to keep disk file in sync
   log_io_.flush();
+  // and to sync, the log records are only durable once they are on the device
+  if (log_fd_ >= 0 && fdatasync(log_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing log");
+  }
   flush_log_ = false;
 }
 
@@ -186,16 +411,77 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Reuse the lowest deallocated page id, otherwise extend the file
+ */
+page_id_t DiskManager::AllocatePage() {
+  page_id_t page_id = ReuseFreePage(1, 0);
+  return page_id != INVALID_PAGE_ID ? page_id : next_page_id_++;
+}
+
+/**
+ * Take the lowest deallocated page id of one residue class out of the free page map
+ */
+page_id_t DiskManager::ReuseFreePage(uint32_t stride, uint32_t offset) {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  // ids are spread evenly over the residue classes, so this looks at about stride ids
+  auto it = std::find_if(free_pages_.begin(), free_pages_.end(), [stride, offset](page_id_t page_id) {
+    return static_cast<uint32_t>(page_id) % stride == offset;
+  });
+  if (it == free_pages_.end()) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t page_id = *it;
+  free_pages_.erase(it);
+  WriteFreePageBit(page_id);
+  return page_id;
+}
+
+/**
+ * Move the next fresh page id past one allocated by a buffer pool
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+void DiskManager::MarkPageAllocated(page_id_t page_id) {
+  page_id_t next_page_id = next_page_id_.load();
+  while (next_page_id <= page_id && !next_page_id_.compare_exchange_weak(next_page_id, page_id + 1)) {
+  }
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
- * This does not actually need to do anything for now.
+ * The page id goes into the free page map until it is allocated again
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (page_id < 0 || io_mode_ == DiskIOMode::MMAP_READ_ONLY) {
+    return;
+  }
+  // AllocatePage would hand the id out once from the free page map and once more when the file gets there
+  if (page_id >= next_page_id_) {
+    LOG_DEBUG("page %d deallocated but never allocated", page_id);
+    return;
+  }
+  if (io_mode_ == DiskIOMode::COMPRESSED) {
+    // the slot goes back to the free slots right away, a reused page id starts over with a fresh one
+    std::scoped_lock scoped_slots_latch(slots_latch_);
+    if (static_cast<size_t>(page_id) < page_slots_.size() && page_slots_[page_id].size_ != 0) {
+      PageSlot slot = page_slots_[page_id];
+      free_slots_[(slot.size_ + SECTOR_SIZE - 1) / SECTOR_SIZE].push_back(slot.sector_);
+      SetPageSlot(page_id, 0, 0);
+    }
+  }
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  if (!free_pages_.insert(page_id).second) {
+    LOG_DEBUG("page %d deallocated twice", page_id);
+    return;
+  }
+  WriteFreePageBit(page_id);
+}
+
+/**
+ * Returns number of deallocated pages that can be reused
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
+size_t DiskManager::GetNumFreePages() {
+  std::scoped_lock scoped_free_pages_latch(free_pages_latch_);
+  return free_pages_.size();
+}
 
 /**
  * Returns number of flushes made so far
@@ -212,6 +498,443 @@ int DiskManager::GetNumWrites() const { return num_writes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Private helper function to read the free page map of a reopened db file
+ * Page ids below the end of the db file or below a free page are taken, new pages start after both
+ */
+void DiskManager::LoadFreePageMap() {
+  int file_size = GetFileSize(file_name_);
+  page_id_t next_page_id = file_size > 0 ? (file_size + PAGE_SIZE - 1) / PAGE_SIZE : 0;
+  std::ifstream fsm(fsm_name_, std::ios::binary);
+  char byte;
+  for (page_id_t base = 0; fsm.get(byte); base += 8) {
+    for (int bit = 0; bit < 8; bit++) {
+      if ((static_cast<unsigned char>(byte) & (1U << bit)) != 0) {
+        free_pages_.insert(base + bit);
+        next_page_id = std::max(next_page_id, base + bit + 1);
+      }
+    }
+  }
+  next_page_id_ = next_page_id;
+}
+
+/**
+ * Private helper function to update one bit of the free page map, called with free_pages_latch_ held
+ */
+void DiskManager::WriteFreePageBit(page_id_t page_id) {
+  if (!fsm_io_.is_open()) {
+    fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in | std::ios::out);
+    // directory or file does not exist
+    if (!fsm_io_.is_open()) {
+      fsm_io_.clear();
+      // create a new file
+      fsm_io_.open(fsm_name_, std::ios::binary | std::ios::trunc | std::ios::out);
+      fsm_io_.close();
+      // reopen with original mode
+      fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in | std::ios::out);
+      if (!fsm_io_.is_open()) {
+        LOG_DEBUG("can't open free page map");
+        return;
+      }
+    }
+  }
+  // the in-memory map already holds the new state, write the whole byte from it
+  page_id_t base = page_id - page_id % 8;
+  unsigned char byte = 0;
+  for (int bit = 0; bit < 8; bit++) {
+    if (free_pages_.count(base + bit) > 0) {
+      byte |= 1U << bit;
+    }
+  }
+  fsm_io_.seekp(base / 8);
+  fsm_io_.put(static_cast<char>(byte));
+  if (fsm_io_.bad()) {
+    LOG_DEBUG("I/O error while writing free page map");
+    return;
+  }
+  fsm_io_.flush();
+}
+
+/**
+ * Compare the checksum of the page data with the one stamped by the last write of the page
+ */
+bool DiskManager::VerifyPage(page_id_t page_id, const char *page_data) {
+  uint32_t stamp = NO_CHECKSUM;
+  checksums_latch_.RLock();
+  if (page_id >= 0 && static_cast<size_t>(page_id) < checksums_.size()) {
+    stamp = checksums_[page_id];
+  }
+  checksums_latch_.RUnlock();
+  if (stamp == NO_CHECKSUM) {
+    return true;
+  }
+  uint32_t crc = Crc32c::Checksum(page_data, PAGE_SIZE);
+  // a page whose CRC is NO_CHECKSUM is stamped with its complement
+  if ((crc == NO_CHECKSUM ? ~NO_CHECKSUM : crc) == stamp) {
+    return true;
+  }
+  num_checksum_failures_ += 1;
+  LOG_WARN("checksum mismatch on page %d: torn write, corruption or short read", page_id);
+  return false;
+}
+
+/**
+ * Private helper function to open the checksum file; without checksums a stale one is removed, unless read-only
+ */
+void DiskManager::OpenChecksums(bool db_file_exists) {
+  bool read_only = io_mode_ == DiskIOMode::MMAP_READ_ONLY;
+  if ((!page_checksums_ || !db_file_exists) && !read_only) {
+    std::remove(checksum_name_.c_str());
+  }
+  if (!page_checksums_) {
+    return;
+  }
+  if (read_only) {
+    // a database that was written without checksums has nothing to verify
+    checksum_fd_ = open(checksum_name_.c_str(), O_RDONLY);
+    if (checksum_fd_ < 0) {
+      return;
+    }
+  } else {
+    checksum_fd_ = open(checksum_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (checksum_fd_ < 0) {
+    throw Exception("can't open checksum file");
+  }
+  struct stat stat_buf;
+  if (fstat(checksum_fd_, &stat_buf) == 0 && stat_buf.st_size > 0) {
+    checksums_.resize(stat_buf.st_size / sizeof(uint32_t));
+    if (pread(checksum_fd_, checksums_.data(), checksums_.size() * sizeof(uint32_t), 0) < 0) {
+      LOG_DEBUG("I/O error while reading checksums");
+      checksums_.assign(checksums_.size(), NO_CHECKSUM);
+    }
+  }
+}
+
+/**
+ * Private helper function to record the checksum of a written page, in memory and in the checksum file
+ * The page and its checksum are two writes, so a crash between them shows up as a mismatch like a torn page would
+ */
+void DiskManager::StampPage(page_id_t page_id, const char *page_data) {
+  if (!page_checksums_) {
+    return;
+  }
+  uint32_t crc = Crc32c::Checksum(page_data, PAGE_SIZE);
+  uint32_t stamp = crc == NO_CHECKSUM ? ~NO_CHECKSUM : crc;
+  checksums_latch_.WLock();
+  if (checksums_.size() <= static_cast<size_t>(page_id)) {
+    checksums_.resize(page_id + 1, NO_CHECKSUM);
+  }
+  checksums_[page_id] = stamp;
+  checksums_latch_.WUnlock();
+  // the buffer pool never writes one page from two threads at once, so the file gets the stamps in memory order
+  if (pwrite(checksum_fd_, &stamp, sizeof(stamp), static_cast<off_t>(page_id) * sizeof(stamp)) !=
+      static_cast<ssize_t>(sizeof(stamp))) {
+    LOG_DEBUG("I/O error while writing checksum");
+  }
+}
+
+/**
+ * Private helper function to open the db file for pread/pwrite, with O_DIRECT in DIRECT mode if the file system has it
+ */
+void DiskManager::OpenPositional() {
+#ifdef O_DIRECT
+  if (io_mode_ == DiskIOMode::DIRECT) {
+    db_fd_ = open(file_name_.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  }
+#endif
+  if (db_fd_ < 0 && io_mode_ == DiskIOMode::DIRECT) {
+    LOG_DEBUG("no O_DIRECT for %s, using the page cache", file_name_.c_str());
+    io_mode_ = DiskIOMode::POSITIONAL;
+  }
+  if (db_fd_ < 0) {
+    db_fd_ = open(file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+  struct stat stat_buf;
+  db_file_size_ = fstat(db_fd_, &stat_buf) == 0 ? stat_buf.st_size : 0;
+}
+
+/**
+ * Private helper function to read a run of consecutive pages with pread, no latch and no stat needed
+ */
+void DiskManager::ReadPositional(page_id_t page_id, const std::vector<char *> &page_data) {
+  // preadv takes at most IOV_MAX buffers
+  for (size_t first = 0; first < page_data.size(); first += IOV_MAX) {
+    size_t num_pages = std::min<size_t>(page_data.size() - first, IOV_MAX);
+    int64_t offset = (static_cast<int64_t>(page_id) + first) * PAGE_SIZE;
+    // only the pages that reach into the file are read, the rest are zeros
+    int64_t in_file = std::clamp<int64_t>(db_file_size_.load() - offset, 0, num_pages * PAGE_SIZE);
+    size_t read_pages = (in_file + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (read_pages == 0) {
+      LOG_DEBUG("I/O error reading past end of file");
+    }
+
+    bool aligned = true;
+    for (size_t i = 0; i < read_pages && io_mode_ == DiskIOMode::DIRECT; i++) {
+      aligned = aligned && reinterpret_cast<uintptr_t>(page_data[first + i]) % PAGE_SIZE == 0;
+    }
+    // O_DIRECT needs aligned buffers, unaligned ones are read into one aligned buffer first
+    std::unique_ptr<char, decltype(&free)> bounce(nullptr, &free);
+    std::vector<iovec> iov(aligned ? read_pages : 1);
+    if (aligned) {
+      for (size_t i = 0; i < read_pages; i++) {
+        iov[i] = {page_data[first + i], PAGE_SIZE};
+      }
+    } else {
+      bounce.reset(static_cast<char *>(aligned_alloc(PAGE_SIZE, read_pages * PAGE_SIZE)));
+      iov[0] = {bounce.get(), read_pages * PAGE_SIZE};
+    }
+
+    ssize_t read_count = 0;
+    if (read_pages > 0) {
+      do {
+        read_count = preadv(db_fd_, iov.data(), static_cast<int>(iov.size()), offset);
+      } while (read_count < 0 && errno == EINTR);
+      if (read_count < 0) {
+        LOG_DEBUG("I/O error while reading");
+        read_count = 0;
+      }
+    }
+    // if file ends before the end of the run, the tail is zeroed
+    for (size_t i = 0; i < num_pages; i++) {
+      char *data = page_data[first + i];
+      auto page_read =
+          static_cast<size_t>(std::clamp<ssize_t>(read_count - static_cast<ssize_t>(i) * PAGE_SIZE, 0, PAGE_SIZE));
+      if (bounce != nullptr && page_read > 0) {
+        memcpy(data, bounce.get() + i * PAGE_SIZE, page_read);
+      }
+      memset(data + page_read, 0, PAGE_SIZE - page_read);
+    }
+  }
+}
+
+/**
+ * Returns the end of the last page slot in bytes
+ */
+int64_t DiskManager::GetCompressedFileSize() {
+  std::scoped_lock scoped_slots_latch(slots_latch_);
+  return static_cast<int64_t>(num_sectors_) * SECTOR_SIZE;
+}
+
+/**
+ * Private helper function to load the page map; the free slots are the gaps between the slots in use
+ */
+void DiskManager::OpenPageMap(bool db_file_exists) {
+  if (!db_file_exists) {
+    std::remove(map_name_.c_str());
+  }
+  if (io_mode_ != DiskIOMode::COMPRESSED) {
+    return;
+  }
+  map_fd_ = open(map_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (map_fd_ < 0) {
+    throw Exception("can't open page map");
+  }
+  struct stat stat_buf;
+  if (fstat(map_fd_, &stat_buf) != 0 || stat_buf.st_size == 0) {
+    return;
+  }
+  page_slots_.resize(stat_buf.st_size / sizeof(PageSlot));
+  if (pread(map_fd_, page_slots_.data(), page_slots_.size() * sizeof(PageSlot), 0) < 0) {
+    throw Exception("can't read page map");
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> used;
+  for (const auto &slot : page_slots_) {
+    if (slot.size_ != 0) {
+      used.emplace_back(slot.sector_, slot.sector_ + (slot.size_ + SECTOR_SIZE - 1) / SECTOR_SIZE);
+    }
+  }
+  std::sort(used.begin(), used.end());
+  for (const auto &[begin, end] : used) {
+    // a gap is cut into slots of at most a page
+    for (uint32_t sector = num_sectors_; sector < begin; sector += SECTORS_PER_PAGE) {
+      free_slots_[std::min(SECTORS_PER_PAGE, begin - sector)].push_back(sector);
+    }
+    num_sectors_ = std::max(num_sectors_, end);
+  }
+}
+
+/**
+ * Private helper function to write a compressed page
+ * The page goes back into its slot if it still fits, so a page rewritten with about the same content stays in place.
+ * Otherwise it is written to a new slot and the map is switched over afterwards, so the old copy stays readable until
+ * then. The buffer pool never reads or writes a page while another write of it is in flight.
+ */
+void DiskManager::WriteCompressed(page_id_t page_id, const char *page_data) {
+  char compressed[PAGE_SIZE];
+  // a page that saves less than a sector is not worth decompressing, it is stored as is
+  size_t size = Lz4::Compress(page_data, PAGE_SIZE, compressed, PAGE_SIZE - SECTOR_SIZE);
+  const char *data = compressed;
+  if (size == 0) {
+    data = page_data;
+    size = PAGE_SIZE;
+  }
+  uint32_t num_sectors = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+  PageSlot old_slot{0, 0, 0};
+  uint32_t sector;
+  {
+    std::scoped_lock scoped_slots_latch(slots_latch_);
+    if (static_cast<size_t>(page_id) < page_slots_.size()) {
+      old_slot = page_slots_[page_id];
+    }
+    bool fits = old_slot.size_ != 0 && (old_slot.size_ + SECTOR_SIZE - 1) / SECTOR_SIZE == num_sectors;
+    sector = fits ? old_slot.sector_ : TakeSlot(num_sectors);
+  }
+
+  ssize_t written = 0;
+  while (written < static_cast<ssize_t>(size)) {
+    ssize_t n = pwrite(db_fd_, data + written, size - written, static_cast<off_t>(sector) * SECTOR_SIZE + written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    // check for I/O error
+    if (n <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      break;
+    }
+    written += n;
+  }
+
+  std::scoped_lock scoped_slots_latch(slots_latch_);
+  if (written < static_cast<ssize_t>(size)) {
+    // the page keeps its old slot, a new one goes back unused
+    if (old_slot.size_ == 0 || sector != old_slot.sector_) {
+      free_slots_[num_sectors].push_back(sector);
+    }
+    return;
+  }
+  // a rewrite that compressed to the same size leaves the page map alone
+  if (sector != old_slot.sector_ || size != old_slot.size_) {
+    SetPageSlot(page_id, sector, static_cast<uint16_t>(size));
+  }
+  if (old_slot.size_ != 0 && sector != old_slot.sector_) {
+    free_slots_[(old_slot.size_ + SECTOR_SIZE - 1) / SECTOR_SIZE].push_back(old_slot.sector_);
+  }
+}
+
+/**
+ * Private helper function to read and decompress a page
+ */
+void DiskManager::ReadCompressed(page_id_t page_id, char *page_data) {
+  PageSlot slot{0, 0, 0};
+  {
+    std::scoped_lock scoped_slots_latch(slots_latch_);
+    if (page_id >= 0 && static_cast<size_t>(page_id) < page_slots_.size()) {
+      slot = page_slots_[page_id];
+    }
+  }
+  if (slot.size_ == 0) {
+    LOG_DEBUG("I/O error reading past end of file");
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  // an incompressible page is read in place
+  char compressed[PAGE_SIZE];
+  char *data = slot.size_ == PAGE_SIZE ? page_data : compressed;
+  ssize_t read_count;
+  do {
+    read_count = pread(db_fd_, data, slot.size_, static_cast<off_t>(slot.sector_) * SECTOR_SIZE);
+  } while (read_count < 0 && errno == EINTR);
+  if (read_count != slot.size_) {
+    LOG_DEBUG("I/O error while reading");
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  if (data == compressed && !Lz4::Decompress(compressed, slot.size_, page_data, PAGE_SIZE)) {
+    LOG_WARN("page %d does not decompress: torn write or corruption", page_id);
+    memset(page_data, 0, PAGE_SIZE);
+  }
+}
+
+/**
+ * Private helper function to find a slot, the smallest free one that is large enough or a new one at the end
+ */
+uint32_t DiskManager::TakeSlot(uint32_t num_sectors) {
+  for (uint32_t size = num_sectors; size <= SECTORS_PER_PAGE; size++) {
+    if (free_slots_[size].empty()) {
+      continue;
+    }
+    uint32_t sector = free_slots_[size].back();
+    free_slots_[size].pop_back();
+    if (size > num_sectors) {
+      free_slots_[size - num_sectors].push_back(sector + num_sectors);
+    }
+    return sector;
+  }
+  uint32_t sector = num_sectors_;
+  num_sectors_ += num_sectors;
+  return sector;
+}
+
+/**
+ * Private helper function to update the page map, in memory and in the page map file
+ */
+void DiskManager::SetPageSlot(page_id_t page_id, uint32_t sector, uint16_t size) {
+  if (page_slots_.size() <= static_cast<size_t>(page_id)) {
+    page_slots_.resize(page_id + 1, PageSlot{0, 0, 0});
+  }
+  page_slots_[page_id] = PageSlot{sector, size, 0};
+  if (pwrite(map_fd_, &page_slots_[page_id], sizeof(PageSlot), static_cast<off_t>(page_id) * sizeof(PageSlot)) !=
+      static_cast<ssize_t>(sizeof(PageSlot))) {
+    LOG_DEBUG("I/O error while writing page map");
+  }
+}
+
+/**
+ * Pass an access pattern hint for a range of the mapping on to madvise
+ */
+bool DiskManager::AdviseMapped(AccessPattern pattern, page_id_t first_page, size_t num_pages) {
+  if (mapped_data_ == nullptr || first_page < 0 || static_cast<size_t>(first_page) >= num_mapped_pages_) {
+    return false;
+  }
+  size_t available = num_mapped_pages_ - first_page;
+  num_pages = num_pages == 0 ? available : std::min(num_pages, available);
+  int advice = MADV_NORMAL;
+  switch (pattern) {
+    case AccessPattern::NORMAL:
+      advice = MADV_NORMAL;
+      break;
+    case AccessPattern::SEQUENTIAL:
+      advice = MADV_SEQUENTIAL;
+      break;
+    case AccessPattern::RANDOM:
+      advice = MADV_RANDOM;
+      break;
+    case AccessPattern::WILLNEED:
+      advice = MADV_WILLNEED;
+      break;
+  }
+  return madvise(mapped_data_ + static_cast<size_t>(first_page) * PAGE_SIZE, num_pages * PAGE_SIZE, advice) == 0;
+}
+
+/**
+ * Private helper function to map the whole db file read-only; the file descriptor is not needed afterwards
+ */
+void DiskManager::OpenMapped() {
+  int fd = open(file_name_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Exception("can't open db file");
+  }
+  struct stat stat_buf;
+  int64_t file_size = fstat(fd, &stat_buf) == 0 ? stat_buf.st_size : 0;
+  db_file_size_ = file_size;
+  // the tail of a partial last page reads as zeros, like a short read
+  num_mapped_pages_ = (file_size + PAGE_SIZE - 1) / PAGE_SIZE;
+  if (num_mapped_pages_ > 0) {
+    void *data = mmap(nullptr, num_mapped_pages_ * PAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw Exception("can't map db file");
+    }
+    mapped_data_ = static_cast<char *>(data);
+  }
+  close(fd);
+}
+
 /**
  * Private helper function to get disk file size
  */
@@ -10,6 +10,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <string>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -18,22 +19,51 @@
 
 namespace bustub {
 
-void BPlusTreeConcurrentControl::lock_one(BPlusTreePage* page){
-  printf("%ld page lock\n",(uint64_t)page);
+Page* BPlusTreeConcurrentControl::lock_one(page_id_t page_id){
   if(this->read_mode()){
-    page->RLock();
-  }else{
-    page->WLock();
+    auto guard=bpman_ref_->FetchPageRead(page_id);
+    if(!guard){
+      return nullptr;
+    }
+    read_guards_.push_back(std::move(guard));
+    return read_guards_.back().GetPage();
   }
-  
-  this->locked_pages_.push_back(page);
+  auto guard=bpman_ref_->FetchPageWrite(page_id);
+  if(!guard){
+    return nullptr;
+  }
+  write_guards_.push_back(std::move(guard));
+  return write_guards_.back().GetPage();
+}
+
+Page* BPlusTreeConcurrentControl::locked_page(page_id_t page_id){
+  for(auto &guard:read_guards_){
+    if(guard.PageId()==page_id){
+      return guard.GetPage();
+    }
+  }
+  for(auto &guard:write_guards_){
+    if(guard.PageId()==page_id){
+      return guard.GetPage();
+    }
+  }
+  return nullptr;
+}
+
+BPlusTreePage* BPlusTreeConcurrentControl::last_locked(){
+  if(this->read_mode()){
+    return read_guards_.back().As<BPlusTreePage>();
+  }
+  return write_guards_.back().As<BPlusTreePage>();
 }
 
 void BPlusTreeConcurrentControl::free_pre(){
-  while(this->locked_pages_.size()>1){
-    auto pre=locked_pages_.front();
-    locked_pages_.pop_front();
-    this->unlock_and_unpin_page(pre);
+  //从根往下依次放掉，只留最后一个
+  while(this->read_guards_.size()>1){
+    read_guards_.pop_front();
+  }
+  while(this->write_guards_.size()>1){
+    write_guards_.pop_front();
   }
 }
 void BPlusTreeConcurrentControl::if_safe_then_free_pre(){
@@ -46,8 +76,8 @@ void BPlusTreeConcurrentControl::if_safe_then_free_pre(){
       //insert 模式，确保子节点不会split，那么就可以释放父节点
       //leaf和internel page split的size阈值不同
       // 小于阈值-1.那么+1后还没到阈值，不会触发split
-      if(this->locked_pages_.back()->GetSize()
-        <this->locked_pages_.back()->SplitSize()-1){
+      if(this->last_locked()->GetSize()
+        <this->last_locked()->SplitSize()-1){
           free_pre();
       }
     }
@@ -63,6 +93,12 @@ void BPlusTreeConcurrentControl::if_safe_then_free_pre(){
 
     }
     break;
+  case BPlusTreeConcurrentControlMode::Lookup:
+    {
+      //只读，拿到子节点的锁后父节点就可以放了
+      free_pre();
+    }
+    break;
   
   default:
     // LOG_ERROR("other concurr not impled");
@@ -70,6 +106,30 @@ void BPlusTreeConcurrentControl::if_safe_then_free_pre(){
     break;
   }
 }
+
+void BPlusTreeConcurrentControl::mark_dirty(page_id_t page_id){
+  for(auto &guard:write_guards_){
+    if(guard.PageId()==page_id){
+      guard.MarkDirty();
+      return;
+    }
+  }
+}
+
+void BPlusTreeConcurrentControl::delete_after_release(page_id_t page_id){
+  deleted_pages_.push_back(page_id);
+}
+
+void BPlusTreeConcurrentControl::release_all(){
+  read_guards_.clear();
+  write_guards_.clear();
+  //page可能又被别的线程pin住了，删不掉就留给replacer换出
+  for(auto page_id:deleted_pages_){
+    bpman_ref_->DeletePage(page_id);
+  }
+  deleted_pages_.clear();
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
                           int leaf_max_size, int internal_max_size)
@@ -103,36 +163,101 @@ bool BPLUSTREE_TYPE::GetValue(
     if(this->root_page_id_==INVALID_PAGE_ID){
       throw Exception(ExceptionType::INVALID,"no root page");
     }
-    auto curpageid=root_page_id_;
-    while(1){
-      // printf("GetValue loop");
-      auto page_=buffer_pool_manager_->FetchPage(curpageid);
-      auto page=(ParentPage*)(LeafPage*)page_->GetData();
-      if(page->IsLeafPage()){
-        LeafPage* lfp=(LeafPage*)page;
-        ValueType ret;
-        if(lfp->Lookup(key,&ret,comparator_)){
-          result->push_back(ret);
-          //bf ret
-          buffer_pool_manager_->UnpinPage(curpageid,true);
-          return true;
+    ReadPageGuard guard;
+    //内部节点走版本号，下降过程中不写任何共享的latch
+    for(int restarts=0;restarts<OPTIMISTIC_RESTARTS;restarts++){
+      if(FindLeafOptimistic(key,&guard)){
+        break;
+      }
+    }
+    if(!guard){
+      //写得太频繁一直校验失败，退回读锁蟹行
+      guard=buffer_pool_manager_->FetchPageRead(root_page_id_);
+      while(1){
+        // printf("GetValue loop");
+        if(!guard){
+          throw Exception(ExceptionType::OUT_OF_MEMORY,"GetValue fetch page failed");
+        }
+        auto page=guard.As<ParentPage>();
+        if(page->IsLeafPage()){
+          break;
         }
-        buffer_pool_manager_->UnpinPage(curpageid,true);
-        return false;
-      }else{
         InternalPage* ip=(InternalPage*)page;
         page_id_t v=ip->Lookup(key,comparator_);
-        buffer_pool_manager_->UnpinPage(curpageid,false);
         if(v<0){
           //没找到
           return false;
         }
-        curpageid=v;
+        //读锁蟹行：先锁住子节点，赋值时才放掉父节点
+        ReadPageGuard child=buffer_pool_manager_->FetchPageRead(v);
+        guard=std::move(child);
       }
     }
-    
-    throw Exception(ExceptionType::INVALID,"cant get here");
-  return false;
+    LeafPage* lfp=guard.As<LeafPage>();
+    ValueType ret;
+    if(lfp->Lookup(key,&ret,comparator_)){
+      result->push_back(ret);
+      return true;
+    }
+    return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::FindLeafOptimistic(const KeyType &key, ReadPageGuard *leaf) {
+  auto root_id=root_page_id_;
+  if(root_id==INVALID_PAGE_ID){
+    return false;
+  }
+  BasicPageGuard parent=buffer_pool_manager_->FetchPageBasic(root_id);
+  if(!parent){
+    throw Exception(ExceptionType::OUT_OF_MEMORY,"FindLeafOptimistic fetch page failed");
+  }
+  //页的类型在初始化之后不会变，不用校验
+  if(parent.As<ParentPage>()->IsLeafPage()){
+    ReadPageGuard root_leaf=parent.UpgradeRead();
+    //锁上之前root可能已经分裂了
+    if(root_id!=root_page_id_){
+      return false;
+    }
+    *leaf=std::move(root_leaf);
+    return true;
+  }
+  uint64_t parent_version=parent.GetPage()->ReadVersion();
+  if(root_id!=root_page_id_){
+    return false;
+  }
+  while(1){
+    auto ip=parent.As<InternalPage>();
+    //可能读到写了一半的节点，size不合理就别去查，免得读出page外
+    int size=ip->GetSize();
+    if(size<=0||size>internal_max_size_+1){
+      return false;
+    }
+    page_id_t child_id=ip->Lookup(key,comparator_);
+    //child id校验过才能拿去fetch
+    if(!parent.GetPage()->ValidateVersion(parent_version)){
+      return false;
+    }
+    BasicPageGuard child=buffer_pool_manager_->FetchPageBasic(child_id);
+    if(!child){
+      throw Exception(ExceptionType::OUT_OF_MEMORY,"FindLeafOptimistic fetch page failed");
+    }
+    if(child.As<ParentPage>()->IsLeafPage()){
+      ReadPageGuard leaf_guard=child.UpgradeRead();
+      //父节点没变，说明锁上的叶子还挂在它下面
+      if(!parent.GetPage()->ValidateVersion(parent_version)){
+        return false;
+      }
+      *leaf=std::move(leaf_guard);
+      return true;
+    }
+    uint64_t child_version=child.GetPage()->ReadVersion();
+    if(!parent.GetPage()->ValidateVersion(parent_version)){
+      return false;
+    }
+    parent=std::move(child);
+    parent_version=child_version;
+  }
 }
 
 /*****************************************************************************
@@ -174,17 +299,17 @@ insert_into_leaf:
 // remember to unpin after using
 // @return new page
 INDEX_TEMPLATE_ARGUMENTS
-Page* BPLUSTREE_TYPE::_NewInternalPage(page_id_t parent_id){
+BasicPageGuard BPLUSTREE_TYPE::_NewInternalPage(page_id_t parent_id){
   page_id_t pid;
-  auto page=buffer_pool_manager_->NewPage(&pid);
-  if(!page) throw Exception(
+  BasicPageGuard guard=buffer_pool_manager_->NewPageGuarded(&pid);
+  if(!guard) throw Exception(
     ExceptionType::OUT_OF_MEMORY,"_NewInternalPage");
   
-  InternalPage* p=PAGE_REF_INTERNEL(page);
+  InternalPage* p=guard.AsMut<InternalPage>();
   new (p) InternalPage();
   p->Init(pid,parent_id,internal_max_size_);
   
-  return page;
+  return guard;
 }
 
 /*
@@ -196,28 +321,26 @@ Page* BPLUSTREE_TYPE::_NewInternalPage(page_id_t parent_id){
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   page_id_t pid;
-  auto page=buffer_pool_manager_->NewPage(&pid);
-  if(page){
+  BasicPageGuard guard=buffer_pool_manager_->NewPageGuarded(&pid);
+  if(guard){
     
-    this->big_mu_.lock();
+    std::lock_guard<std::mutex> hold(big_mu_);
     //此处root page id的更新一定得是原子的
     //所以start失败就得执行另一种情况
     if(root_page_id_!=INVALID_PAGE_ID){
-      big_mu_.unlock();
+      guard.Drop();
+      buffer_pool_manager_->DeletePage(pid);
       return false;
     }
-    root_page_id_=pid;//获取到pageid
-
-    UpdateRootPageId(root_page_id_);
-    new (page->GetData()) LeafPage();
-    LeafPage* lfpagecast=(LeafPage*)page->GetData();
+    //先把叶子初始化好，再公开root page id
+    new (guard.AsMut<LeafPage>()) LeafPage();
+    LeafPage* lfpagecast=guard.AsMut<LeafPage>();
     lfpagecast->Init(pid,INVALID_PAGE_ID,leaf_max_size_);
-    lfpagecast->WLock();
     lfpagecast->Insert(key,value,comparator_);
-    lfpagecast->WUnlock();
-    buffer_pool_manager_->UnpinPage(pid,true);
+    guard.Drop();
 
-    big_mu_.unlock();
+    root_page_id_=pid;//获取到pageid
+    UpdateRootPageId(root_page_id_);
     return true;
     // root_page_type=IndexPageType::LEAF_PAGE;//初始为leafpage类型
     // InitPageFromType(page,root_page_type);
@@ -244,22 +367,22 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
   LeafPage* lf=(LeafPage*)curpage->GetData();
   // auto newsize=
   lf->Insert(key,value,comparator_);
+  conccur.mark_dirty(lf->GetPageId());
   // printf("%d\n",lf->GetSize());
   // printf("%d\n",lf->GetMaxSize()+2);
   // printf("%d\n",lf->SplitSize());
   // printf("after insert sz %d, max sz %d\n",newsize,lf->GetMaxSize());
-  printf("lf sz %d %d\n",lf->GetSize(),lf->SplitSize());
   if(lf->GetSize()==lf->SplitSize()){
     //到达了maxsize，需要将leaf split
-    LeafPage* newp=Split(lf);
+    BasicPageGuard new_guard;
+    LeafPage* newp=Split(lf,&new_guard);
     // conccur.lock_one(newp);
     //1.更新父节点
     {
       //这里的key为newp中最小值
       InsertIntoParent(lf,newp->GetItem(0).first,newp,conccur);
     }
-    //2.新page，也需要unpin一下
-    // buffer_pool_manager_->UnpinPage(newp->GetPageId(),true);
+    //2.新page由new_guard在这里unpin
   }
   //路径上被搜索到的都被concurr锁了,concurr解锁时自动unpin
   // buffer_pool_manager_->UnpinPage(lf->GetPageId(),true);
@@ -275,7 +398,7 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
+N *BPLUSTREE_TYPE::Split(N *node, BasicPageGuard *new_guard) {
   BPlusTreePage*n=node;
   if(n->IsLeafPage()){
     if(n->GetSize()!=n->GetMaxSize()+1){
@@ -288,9 +411,9 @@ N *BPLUSTREE_TYPE::Split(N *node) {
   }
   
   page_id_t pid;
-  auto newp_=buffer_pool_manager_->NewPage(&pid);
-  if(newp_){
-    auto newp=(ParentPage*)(LeafPage*)(newp_->GetData());
+  *new_guard=buffer_pool_manager_->NewPageGuarded(&pid);
+  if(*new_guard){
+    auto newp=new_guard->AsMut<ParentPage>();
     if(n->IsLeafPage()){
       // printf("split leaf\n");
       //leafpage copy
@@ -303,13 +426,14 @@ N *BPLUSTREE_TYPE::Split(N *node) {
       auto oldnext=old->GetNextPageId();
       old->SetNextPageId(lfp->GetPageId());
       lfp->SetNextPageId(oldnext);
-      printf("split sz %d\n",lfp->SplitSize());
       return reinterpret_cast<N*>(lfp);
     }else{
       // printf("split internel\n");
       InternalPage*old=reinterpret_cast<InternalPage*>(n);
-      InternalPage*newp=PAGE_REF_INTERNEL(newp_);
-      newp->Init(newp_->GetPageId(),n->GetParentPageId(),internal_max_size_);
+      InternalPage*newp=new_guard->AsMut<InternalPage>();
+      //和叶子一样先构造，SplitSize这些虚函数要靠它
+      new ((char*)newp) InternalPage();
+      newp->Init(pid,n->GetParentPageId(),internal_max_size_);
       old->MoveHalfTo(newp,buffer_pool_manager_);
       
       return reinterpret_cast<N*>(newp);
@@ -341,24 +465,28 @@ void BPLUSTREE_TYPE::InsertIntoParent(
     //1.1没有父节点，需要创建父节点
     if(old_node->GetParentPageId()==INVALID_PAGE_ID){
       // printf("new parent for 2 page\n");
-      auto newip_mem=_NewInternalPage(INVALID_PAGE_ID);
-      InternalPage* ip=PAGE_REF_INTERNEL(newip_mem);
+      BasicPageGuard newip_guard=_NewInternalPage(INVALID_PAGE_ID);
+      InternalPage* ip=newip_guard.AsMut<InternalPage>();
       ip->BeginWithTwoNode(old_node->GetPageId(),key,new_node->GetPageId());
       // concurr.lock_one(ip);
       // buffer_pool_manager_->UnpinPage(ip->GetPageId(),true);
       if(old_node->GetPageId()==root_page_id_){
-        root_page_id_=newip_mem->GetPageId();
+        root_page_id_=ip->GetPageId();
         UpdateRootPageId(root_page_id_);
       }
-      old_node->SetParentPageId(newip_mem->GetPageId());
-      new_node->SetParentPageId(newip_mem->GetPageId());
+      old_node->SetParentPageId(ip->GetPageId());
+      new_node->SetParentPageId(ip->GetPageId());
       // newip->PopulateNewRoot();
       return;
     }
     // printf("exist parent for 2 page %d\n",old_node->GetParentPageId());
     //1.2将newnode加入到oldnode的父节点中
-    auto ipmem=buffer_pool_manager_->FetchPage(old_node->GetParentPageId());
-    ip=PAGE_REF_INTERNEL(ipmem);
+    //父节点还在concurr的写锁里，这里只pin
+    BasicPageGuard ip_guard=buffer_pool_manager_->FetchPageBasic(old_node->GetParentPageId());
+    if(!ip_guard){
+      throw Exception(ExceptionType::OUT_OF_MEMORY,"InsertIntoParent fetch parent failed");
+    }
+    ip=ip_guard.AsMut<InternalPage>();
     // concurr.lock_one(ip);
     // printf("- InsertIntoParent 1\n");
     //加入到的位置并不总是在最后，可能分裂前的节点在父节点中的区间在中间，
@@ -371,12 +499,11 @@ void BPLUSTREE_TYPE::InsertIntoParent(
     // printf("- InsertIntoParent 3\n");
     if(ip->ReachSplitSize()){
       //达到最大，需要分裂
-      InternalPage*newip= Split(ip);
+      BasicPageGuard newip_guard;
+      InternalPage*newip= Split(ip,&newip_guard);
       // concurr.lock_one(newip);
       InsertIntoParent(ip,newip->KeyAt(0),newip,concurr);
-      // buffer_pool_manager_->UnpinPage(newip->GetPageId(),true);
     }
-    buffer_pool_manager_->UnpinPage(ip->GetPageId(),true);
     // printf("InsertIntoParent done\n");
 }
 
@@ -413,8 +540,6 @@ FindSibResult BPLUSTREE_TYPE::FindSibInInternel(
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(
   const KeyType &key, Transaction *transaction) {
-    //export this private
-    auto bpman=buffer_pool_manager_;
     BPlusTreeConcurrentControl concurr(
       BPlusTreeConcurrentControlMode::Delete,buffer_pool_manager_
     );
@@ -439,6 +564,7 @@ void BPLUSTREE_TYPE::Remove(
     //1.del succ
     if(sz!=oldsz){
       // printf("del succ\n");
+      concurr.mark_dirty(lp->GetPageId());
       //1.>=half sz
       if(lp->GetSize()>=lp->GetMaxSize()/2){
         //根据pdf，半满情况下
@@ -456,21 +582,20 @@ void BPLUSTREE_TYPE::Remove(
             // {
             //   auto consumehold=std::move(holdpage);
             // }
-            printf("pa unique unpined page remove p %d\n",root_page_id_);
-            if(!buffer_pool_manager_->DeletePage(root_page_id_)){
-              throw Exception(ExceptionType::INVALID,"lf page del failed");
-            }
+            //叶子还被concurr锁着，放锁之后再删
+            concurr.delete_after_release(root_page_id_);
             root_page_id_=INVALID_PAGE_ID;
           }
           // throw Exception(ExceptionType::NOT_IMPLEMENTED,"remove root is not impled");
         }else{
           //2.1
-          Page* parent_p_mem=buffer_pool_manager_->FetchPage(lp->GetParentPageId());
-          InternalPage* parent_p=PAGE_REF_INTERNEL(parent_p_mem);
-          pa::Unique<Page*> holdpage(parent_p_mem,[&](Page*& v){
-            // printf("pa unique unpin page remove parent\n");
-            bpman->UnpinPage(v->GetPageId(),true);
-          });
+          //删除时路径上的page都不放，父节点已经被concurr写锁住
+          Page* parent_page=concurr.locked_page(lp->GetParentPageId());
+          if(!parent_page){
+            throw Exception(ExceptionType::INVALID,"parent page not locked");
+          }
+          InternalPage* parent_p=PAGE_REF_INTERNEL(parent_page);
+          concurr.mark_dirty(parent_p->GetPageId());
           //2.1有共同父节点的兄弟节点
           if(parent_p->GetSize()>1){
             //先找到兄弟节点,
@@ -481,16 +606,13 @@ void BPLUSTREE_TYPE::Remove(
             auto sib_on_left=!res.sib_on_right;
 
             // printf("get sib succ\n");
-            Page* sib_lp_mem=buffer_pool_manager_->FetchPage(sibling_pid);
-            if(!sib_lp_mem){
+            //兄弟节点不在路径上，也要写锁住：改它要推进版本号，乐观读才知道要重来
+            Page* sib_page=concurr.lock_one(sibling_pid);
+            if(!sib_page){
               throw Exception(ExceptionType::INVALID,"fetch sibling page failed");
             }
-            auto bpman=buffer_pool_manager_;
-            pa::Unique<Page*> holdpage(sib_lp_mem,[&](Page*& v){
-              // printf("pa unique unpin page remove sib\n");
-              bpman->UnpinPage(v->GetPageId(),true);
-            });
-            LeafPage* sib_lp=PAGE_REF_LEAF(sib_lp_mem);
+            LeafPage* sib_lp=PAGE_REF_LEAF(sib_page);
+            concurr.mark_dirty(sibling_pid);
             //  2.1.1 兄弟节点>半满
             //  与兄弟节点 redistribute(兄弟节点拿出前面的给当前的)
             if(sib_lp->GetSize()>sib_lp->GetMaxSize()/2){
@@ -510,8 +632,7 @@ void BPLUSTREE_TYPE::Remove(
             //  与兄弟节点 coalesce(合并)
             else if(sib_lp->GetSize()==sib_lp->GetMaxSize()/2){
               //coalese, 与其他节点合并，会导致从父节点中移除某个数据
-              printf("coalesce\n");
-              Coalesce(&sib_lp,&lp,&parent_p,i,!sib_on_left,transaction);
+              Coalesce(&sib_lp,&lp,&parent_p,i,!sib_on_left,concurr,transaction);
               
               //throw Exception(ExceptionType::NOT_IMPLEMENTED,"colease is not handled");
               // Coalesce(&sib_lp,&lp,&parent_p);
@@ -563,39 +684,34 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::CoalesceEdgeHandle(InternalPage** parent,
   KeyType old_parent_first_key,
+  BPlusTreeConcurrentControl& concurr,
   Transaction *transaction){
-    auto bpman=buffer_pool_manager_;    
     if((*parent)->GetSize()-1>=(*parent)->GetMaxSize()/2){
     
     if(root_page_id_==(*parent)->GetPageId()){
       
     }else{//父节点没有达到半满，需要补充
       //load parent
-      // 加载父节点的父节点，用于获取父节点的兄弟节点。
-      Page* parent_parent=buffer_pool_manager_->FetchPage((*parent)->GetParentPageId());
+      // 加载父节点的父节点，用于获取父节点的兄弟节点。它也在路径上，已经被concurr写锁住
+      Page* parent_parent=concurr.locked_page((*parent)->GetParentPageId());
       if(!parent_parent){
-        throw Exception(ExceptionType::INVALID,"parent's parent not found");
+        throw Exception(ExceptionType::INVALID,"parent's parent not locked");
       }
-      pa::Unique<Page*> holdpage_parent(parent_parent,[&](Page*& v){
-        // printf("pa unique unpin page coal\n");
-        bpman->UnpinPage(v->GetPageId(),true);
-      });
       InternalPage* parent_parent_ip=PAGE_REF_INTERNEL(parent_parent);
+      concurr.mark_dirty(parent_parent_ip->GetPageId());
       auto parent_i=parent_parent_ip->LookupKeyIndex(
         old_parent_first_key,comparator_);
       // std::cout<<"look for key "<<old_parent_first_key<<std::endl;
       //load sib page
       auto sib_pos=FindSibInInternel(parent_i,parent_parent_ip);
       auto sib_pid=parent_parent_ip->ValueAt(sib_pos.sib_index);
-      Page* sib_page_mem=buffer_pool_manager_->FetchPage(sib_pid);
-      if(!sib_page_mem){
+      //和叶子的兄弟一样写锁住，锁留在concurr里到删除结束
+      Page* sib_locked=concurr.lock_one(sib_pid);
+      if(!sib_locked){
         throw Exception(ExceptionType::INVALID,"fetch page failed coalesce");
       }
-      pa::Unique<Page*> holdpage_sib(sib_page_mem,[&](Page*& v){
-        // printf("pa unique unpin page coal\n");
-        bpman->UnpinPage(v->GetPageId(),true);
-      });
-      InternalPage* sib_page=PAGE_REF_INTERNEL(sib_page_mem);
+      InternalPage* sib_page=PAGE_REF_INTERNEL(sib_locked);
+      concurr.mark_dirty(sib_pid);
       
       //大于半满 redis
       // 因为第一个节点是dummy node，所以size-1
@@ -615,7 +731,7 @@ bool BPLUSTREE_TYPE::CoalesceEdgeHandle(InternalPage** parent,
       else if(sib_page->GetSize()-1==sib_page->GetMaxSize()/2){
         // printf("coal in coal\n");
         Coalesce(&sib_page,parent,&parent_parent_ip,parent_i,
-          sib_pos.sib_on_right,transaction);
+          sib_pos.sib_on_right,concurr,transaction);
       }else{
         throw Exception(ExceptionType::INVALID,"sib page cant < M/2");
       }
@@ -627,13 +743,13 @@ INDEX_TEMPLATE_ARGUMENTS
 // template <typename N>
 bool BPLUSTREE_TYPE::CoalesceCheckParentRootExpire(
   BPlusTreePage* one_childpage,
-  InternalPage*parent
+  InternalPage*parent,
+  BPlusTreeConcurrentControl& concurr
 ) {
   if((parent)->GetPageId()==root_page_id_&&(parent)->GetSize()==1){
       
       // printf(" parent root expire\n");
-      buffer_pool_manager_->UnpinPage(root_page_id_,false);
-      buffer_pool_manager_->DeletePage(root_page_id_);
+      concurr.delete_after_release(root_page_id_);
       root_page_id_=one_childpage->GetPageId();
       UpdateRootPageId(root_page_id_);
       one_childpage->SetParentPageId(INVALID_PAGE_ID);
@@ -646,7 +762,9 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Coalesce(InternalPage **neighbor_node, InternalPage **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
                               int index,
-                              bool sib_on_right, Transaction *transaction) {
+                              bool sib_on_right,
+                              BPlusTreeConcurrentControl& concurr,
+                              Transaction *transaction) {
 
  //used for search position in parent page                 
   auto old_parent_first_key=(*parent)->KeyAt(1);
@@ -655,13 +773,11 @@ bool BPLUSTREE_TYPE::Coalesce(InternalPage **neighbor_node, InternalPage **node,
     // neighbor move to node
     (*neighbor_node)->MoveAllTo(*node,(*parent)->KeyAt(index+1),buffer_pool_manager_);
     (*parent)->Remove(index+1);
-    buffer_pool_manager_->UnpinPage((*neighbor_node)->GetPageId(),false);
-    if(!buffer_pool_manager_->DeletePage((*neighbor_node)->GetPageId())){
-      throw Exception(ExceptionType::INVALID,"coalesce delete page failed");
-    }
+    //调用者的guard还pin着这个page，放掉之后再删
+    concurr.delete_after_release((*neighbor_node)->GetPageId());
 
     
-    if(CoalesceCheckParentRootExpire(*node,*parent)){
+    if(CoalesceCheckParentRootExpire(*node,*parent,concurr)){
       return true;
     }
   }else{
@@ -671,16 +787,13 @@ bool BPLUSTREE_TYPE::Coalesce(InternalPage **neighbor_node, InternalPage **node,
     (*parent)->Remove(index);
      
     
-    buffer_pool_manager_->UnpinPage((*node)->GetPageId(),false);
-    if(!buffer_pool_manager_->DeletePage((*node)->GetPageId())){
-      throw Exception(ExceptionType::INVALID,"coalesce delete page failed");
-    }
+    concurr.delete_after_release((*node)->GetPageId());
 
-    if(CoalesceCheckParentRootExpire(*neighbor_node,*parent)){
+    if(CoalesceCheckParentRootExpire(*neighbor_node,*parent,concurr)){
       return true;
     }
   }
-  return CoalesceEdgeHandle(parent,old_parent_first_key,transaction);
+  return CoalesceEdgeHandle(parent,old_parent_first_key,concurr,transaction);
   // throw Exception(ExceptionType::NOT_IMPLEMENTED,"Coalesce failed");
   // return false;
 }
@@ -690,7 +803,9 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Coalesce(LeafPage **neighbor_node, LeafPage **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
                               int index,
-                              bool sib_on_right, Transaction *transaction) { 
+                              bool sib_on_right,
+                              BPlusTreeConcurrentControl& concurr,
+                              Transaction *transaction) { 
   //used for search position in parent page                 
   auto old_parent_first_key=(*parent)->KeyAt(1);
   if(sib_on_right){
@@ -699,12 +814,10 @@ bool BPLUSTREE_TYPE::Coalesce(LeafPage **neighbor_node, LeafPage **node,
     (*neighbor_node)->MoveAllTo(*node);
     (*parent)->Remove(index+1);
     (*node)->SetNextPageId((*neighbor_node)->GetNextPageId());
-    buffer_pool_manager_->UnpinPage((*neighbor_node)->GetPageId(),false);
-    if(!buffer_pool_manager_->DeletePage((*neighbor_node)->GetPageId())){
-      throw Exception(ExceptionType::INVALID,"coalesce delete page failed");
-    }
+    //调用者的guard还pin着这个page，放掉之后再删
+    concurr.delete_after_release((*neighbor_node)->GetPageId());
     
-    if(CoalesceCheckParentRootExpire(*node,*parent)){
+    if(CoalesceCheckParentRootExpire(*node,*parent,concurr)){
       return true;
     }
   }else{
@@ -715,16 +828,13 @@ bool BPLUSTREE_TYPE::Coalesce(LeafPage **neighbor_node, LeafPage **node,
      
     (*neighbor_node)->SetNextPageId((*node)->GetNextPageId());
     
-    buffer_pool_manager_->UnpinPage((*node)->GetPageId(),false);
-    if(!buffer_pool_manager_->DeletePage((*node)->GetPageId())){
-      throw Exception(ExceptionType::INVALID,"coalesce delete page failed");
-    }
+    concurr.delete_after_release((*node)->GetPageId());
 
-    if(CoalesceCheckParentRootExpire(*neighbor_node,*parent)){
+    if(CoalesceCheckParentRootExpire(*neighbor_node,*parent,concurr)){
       return true;
     }
   }
-  return CoalesceEdgeHandle(parent,old_parent_first_key,transaction);
+  return CoalesceEdgeHandle(parent,old_parent_first_key,concurr,transaction);
   // throw Exception(ExceptionType::NOT_IMPLEMENTED,"Coalesce failed");
   // return false;
 }
@@ -859,11 +969,18 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
   //找到叶节点
   
   while(1){
-    curpage=buffer_pool_manager_->FetchPage(curpageid);
+    if(conccur){
+      //锁和pin都交给concurr的guard
+      curpage=conccur->lock_one(curpageid);
+    }else{
+      curpage=buffer_pool_manager_->FetchPage(curpageid);
+    }
+    if(!curpage){
+      throw Exception(ExceptionType::OUT_OF_MEMORY,"FindLeafPage fetch page failed");
+    }
     ParentPage* page=(ParentPage*)(LeafPage*)curpage->GetData();
     // ParentPage* page2=reinterpret_cast<ParentPage*>(curpage->GetData());
     if(conccur){
-      conccur->lock_one(page);
       //第一层没有pre
       if(curpageid!=root_page_id_){
         conccur->if_safe_then_free_pre();
@@ -918,8 +1035,8 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_
-    ->FetchPage(HEADER_PAGE_ID));
+  WritePageGuard header_guard = buffer_pool_manager_->FetchPageWrite(HEADER_PAGE_ID);
+  HeaderPage *header_page = header_guard.AsMut<HeaderPage>();
   if (insert_record != 0) {
     // create a new record<index_name + root_page_id> in header_page
     header_page->InsertRecord(index_name_, root_page_id_);
@@ -927,7 +1044,6 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
 /*
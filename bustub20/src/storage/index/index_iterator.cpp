@@ -31,10 +31,7 @@ void INDEXITERATOR_TYPE::init(int pos,Page* curpage){
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() {
-    if(curpage_){
-        //结束对page的持有，应该unpin
-        bpman_->UnpinPage(curpage_->GetPageId(),false);
-    }
+    //持有的叶子在concurr的guard里，concurr销毁时解锁+unpin
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -59,7 +56,6 @@ const MappingType &INDEXITERATOR_TYPE::operator*() {
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { 
-    printf("plus\n");
     if(isEnd()){
         throw Exception(ExceptionType::OUT_OF_RANGE,"IndexIterator is at end, cant plus");
     }
@@ -67,10 +63,24 @@ INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
      LeafPage*lp=PAGE_REF_LEAF(curpage_);
     if(pos_==lp->GetSize()){
         page_id_t nextpid= lp->GetNextPageId();
-        curpage_= bpman_->FetchPage(nextpid);
         pos_=0;
+        if(nextpid==INVALID_PAGE_ID){
+            concurr_->release_all();
+            curpage_=nullptr;
+            return *this;
+        }
+        //先锁住下一个叶子，再放掉当前的
+        curpage_= concurr_->lock_one(nextpid);
+        concurr_->if_safe_then_free_pre();
+        //顺着叶子链往后扫，下一个叶子先让后台读进来
+        if(curpage_){
+            LeafPage*nextlp=PAGE_REF_LEAF(curpage_);
+            page_id_t prefetchpid=nextlp->GetNextPageId();
+            if(prefetchpid!=INVALID_PAGE_ID){
+                bpman_->Prefetch(prefetchpid);
+            }
+        }
     }
-printf("plus\n");
     return *this;
     // throw std::runtime_error("unimplemented");
      }
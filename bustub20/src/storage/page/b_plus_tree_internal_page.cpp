@@ -224,15 +224,12 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(
   SetSize(GetSize()+size);
   //此处要更新子page的parent指针
   for(int i=0;i<size;i++){
-    Page* p=buffer_pool_manager->FetchPage( items[i].second);
-    if(!p){
+    BasicPageGuard guard=buffer_pool_manager->FetchPageBasic(items[i].second);
+    if(!guard){
       throw Exception(ExceptionType::INVALID,"internel copy n from fetch page failed");
     }
-    BPlusTreePage* bppage=(BPlusTreePage*)p->GetData();
-    bppage->SetParentPageId(GetPageId());
+    guard.AsMut<BPlusTreePage>()->SetParentPageId(GetPageId());
     // printf("change page%d parent from %d to %d",);
-
-    buffer_pool_manager->UnpinPage(items[i].second,true);
   }
 }
 
@@ -304,10 +301,8 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
   array[GetSize()]=pair;
   IncreaseSize(1);
   std::cout<<std::endl;
-  Page* page_mem=buffer_pool_manager->FetchPage(pair.second);
-  BPlusTreePage* page=(BPlusTreePage*) page_mem->GetData();
-  page->SetParentPageId(this->GetPageId());
-  buffer_pool_manager->UnpinPage(pair.second,true);
+  BasicPageGuard guard=buffer_pool_manager->FetchPageBasic(pair.second);
+  guard.AsMut<BPlusTreePage>()->SetParentPageId(this->GetPageId());
 }
 
 /*
@@ -335,10 +330,8 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, Buff
   array[0]=pair;
   IncreaseSize(1);
 
-  Page* page_mem=buffer_pool_manager->FetchPage(pair.second);
-  BPlusTreePage* page=(BPlusTreePage*) page_mem->GetData();
-  page->SetParentPageId(this->GetPageId());
-  buffer_pool_manager->UnpinPage(pair.second,true);
+  BasicPageGuard guard=buffer_pool_manager->FetchPageBasic(pair.second);
+  guard.AsMut<BPlusTreePage>()->SetParentPageId(this->GetPageId());
   // page->
 }
 
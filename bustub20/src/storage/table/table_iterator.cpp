@@ -35,19 +35,22 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  auto cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId());
+  assert(cur_guard);  // all pages are pinned
+  auto cur_page = cur_guard.As<TablePage>();
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      auto next_page_id = cur_page->GetNextPageId();
+      cur_guard.Drop();
+      cur_guard = buffer_pool_manager->FetchPageRead(next_page_id);
+      cur_page = cur_guard.As<TablePage>();
+      // Read the page after this one in the background while this page's tuples are being consumed.
+      if (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
+        buffer_pool_manager->Prefetch(cur_page->GetNextPageId());
+      }
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -58,9 +61,7 @@ TableIterator &TableIterator::operator++() {
   if (*this != table_heap_->End()) {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
+  // cur_guard releases the page only after the tuple is copied
   return *this;
 }
 
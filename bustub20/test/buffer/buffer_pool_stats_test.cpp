@@ -0,0 +1,100 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats_test.cpp
+//
+// Identification: test/buffer/buffer_pool_stats_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_stats.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, SampleTest) {
+  BufferPoolCounters counters;
+  auto stats = counters.Snapshot();
+  EXPECT_EQ(0, stats.HitRatio());
+  EXPECT_EQ(0, stats.FlushLatencyPercentileUs(0.99));
+
+  // Scenario: hits, misses and evictions are plain counts.
+  for (int i = 0; i < 3; i++) {
+    counters.RecordHit();
+  }
+  counters.RecordMiss();
+  counters.RecordEviction(true);
+  counters.RecordEviction(false);
+  counters.RecordPrefetched(5);
+  stats = counters.Snapshot();
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_DOUBLE_EQ(0.75, stats.HitRatio());
+  EXPECT_EQ(2, stats.evictions);
+  EXPECT_EQ(1, stats.dirty_evictions);
+  EXPECT_EQ(5, stats.prefetched);
+
+  // Scenario: write-backs land in power of two buckets; percentiles report the bucket's upper bound.
+  counters.RecordWriteBack(std::chrono::nanoseconds(500));
+  counters.RecordWriteBack(std::chrono::microseconds(1));
+  counters.RecordWriteBack(std::chrono::microseconds(3));
+  for (int i = 0; i < 96; i++) {
+    counters.RecordWriteBack(std::chrono::microseconds(100));
+  }
+  counters.RecordWriteBack(std::chrono::seconds(10));
+  stats = counters.Snapshot();
+  EXPECT_EQ(100, stats.write_backs);
+  EXPECT_EQ(1, stats.flush_latency_us[0]);
+  EXPECT_EQ(1, stats.flush_latency_us[1]);
+  EXPECT_EQ(1, stats.flush_latency_us[2]);
+  EXPECT_EQ(96, stats.flush_latency_us[7]);
+  EXPECT_EQ(1, stats.flush_latency_us[BufferPoolStats::FLUSH_LATENCY_BUCKETS - 1]);
+  EXPECT_EQ(1, stats.FlushLatencyPercentileUs(0));
+  EXPECT_EQ(128, stats.FlushLatencyPercentileUs(0.5));
+  EXPECT_EQ(128, stats.FlushLatencyPercentileUs(0.99));
+  EXPECT_EQ(1U << (BufferPoolStats::FLUSH_LATENCY_BUCKETS - 1), stats.FlushLatencyPercentileUs(1));
+
+  // Scenario: instances add up.
+  BufferPoolStats total;
+  total += stats;
+  total += stats;
+  EXPECT_EQ(6, total.hits);
+  EXPECT_EQ(192, total.flush_latency_us[7]);
+  EXPECT_DOUBLE_EQ(0.75, total.HitRatio());
+  EXPECT_NE(std::string::npos, total.ToString().find("hits=6 misses=2 hit_ratio=0.7500"));
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, PinWaitTest) {
+  BufferPoolCounters counters;
+  std::mutex latch;
+
+  // Scenario: an uncontended latch is not a wait.
+  { auto lock = counters.LockAndRecordWait(&latch); }
+  EXPECT_EQ(0, counters.Snapshot().pin_waits);
+
+  // Scenario: a latch held by another thread is, and the wait is timed.
+  std::unique_lock<std::mutex> held(latch);
+  std::thread waiter([&] {
+    auto lock = counters.LockAndRecordWait(&latch);
+    EXPECT_TRUE(lock.owns_lock());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  held.unlock();
+  waiter.join();
+  auto stats = counters.Snapshot();
+  EXPECT_EQ(1, stats.pin_waits);
+  EXPECT_GE(stats.pin_wait_ns, 10000000);
+}
+
+}  // namespace bustub
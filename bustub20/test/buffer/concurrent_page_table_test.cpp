@@ -0,0 +1,178 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// concurrent_page_table_test.cpp
+//
+// Identification: test/buffer/concurrent_page_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/concurrent_page_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(ConcurrentPageTableTest, SampleTest) {
+  ConcurrentPageTable table(10);
+  frame_id_t fid;
+
+  EXPECT_FALSE(table.Find(0, &fid));
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(table.Insert(i * 3, i));
+  }
+  EXPECT_EQ(10, table.Size());
+  EXPECT_FALSE(table.Insert(3, 7));
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(table.Find(i * 3, &fid));
+    EXPECT_EQ(i, fid);
+  }
+  EXPECT_FALSE(table.Find(1, &fid));
+
+  EXPECT_TRUE(table.Remove(3));
+  EXPECT_FALSE(table.Remove(3));
+  EXPECT_FALSE(table.Find(3, &fid));
+  EXPECT_EQ(9, table.Size());
+
+  // Frames get rebound to new pages all the time; the slot must be reusable.
+  EXPECT_TRUE(table.Insert(100, 1));
+  ASSERT_TRUE(table.Find(100, &fid));
+  EXPECT_EQ(1, fid);
+}
+
+// NOLINTNEXTLINE
+TEST(ConcurrentPageTableTest, OverflowChainTest) {
+  // A tiny table forces entries to spill past their home bucket.
+  const int num_frames = 64;
+  ConcurrentPageTable table(num_frames);
+  frame_id_t fid;
+
+  for (page_id_t round = 0; round < 50; round++) {
+    for (int i = 0; i < num_frames; i++) {
+      ASSERT_TRUE(table.Insert(round * num_frames + i, i));
+    }
+    for (int i = 0; i < num_frames; i++) {
+      ASSERT_TRUE(table.Find(round * num_frames + i, &fid));
+      EXPECT_EQ(i, fid);
+    }
+    // Remove every other entry first so that removal in the middle of a chain is covered.
+    for (int i = 0; i < num_frames; i += 2) {
+      ASSERT_TRUE(table.Remove(round * num_frames + i));
+    }
+    for (int i = 1; i < num_frames; i += 2) {
+      ASSERT_TRUE(table.Find(round * num_frames + i, &fid));
+      EXPECT_EQ(i, fid);
+    }
+    for (int i = 1; i < num_frames; i += 2) {
+      ASSERT_TRUE(table.Remove(round * num_frames + i));
+    }
+    EXPECT_EQ(0, table.Size());
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(ConcurrentPageTableTest, ConcurrentReadWriteTest) {
+  // Readers must never see a stable entry go missing or map to the wrong frame while a writer churns other entries.
+  const int num_frames = 256;
+  const int num_stable = num_frames / 2;
+  ConcurrentPageTable table(num_frames);
+  for (int i = 0; i < num_stable; i++) {
+    table.Insert(i, i);
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      frame_id_t fid;
+      while (!stop.load()) {
+        for (int i = 0; i < num_stable; i++) {
+          if (!table.Find(i, &fid) || fid != i) {
+            errors++;
+          }
+        }
+      }
+    });
+  }
+
+  page_id_t next = num_stable;
+  for (int round = 0; round < 2000; round++) {
+    for (int i = 0; i < num_frames - num_stable; i++) {
+      table.Insert(next + i, num_stable + i);
+    }
+    for (int i = 0; i < num_frames - num_stable; i++) {
+      table.Remove(next + i);
+    }
+    next += num_frames - num_stable;
+  }
+  stop = true;
+  for (auto &t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, errors.load());
+}
+
+// NOLINTNEXTLINE
+TEST(ConcurrentPageTableTest, HitPathScalingBenchmark) {
+  // Compares buffer-hit lookups against the std::unordered_map + std::mutex page table the buffer pool used before.
+  // Throughput numbers are printed, not asserted; they only mean something on a machine with enough cores.
+  const int num_frames = 1024;
+  const int lookups_per_thread = 200000;
+  ConcurrentPageTable table(num_frames);
+  std::unordered_map<page_id_t, frame_id_t> map;
+  std::mutex latch;
+  for (int i = 0; i < num_frames; i++) {
+    table.Insert(i, i);
+    map[i] = i;
+  }
+
+  auto run = [&](int num_threads, bool use_table) {
+    std::atomic<int64_t> found{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        int64_t local = 0;
+        frame_id_t fid;
+        for (int i = 0; i < lookups_per_thread; i++) {
+          page_id_t pid = (i * 7 + t) % num_frames;
+          if (use_table) {
+            local += table.Find(pid, &fid) ? 1 : 0;
+          } else {
+            std::lock_guard<std::mutex> guard(latch);
+            local += map.count(pid);
+          }
+        }
+        found += local;
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(static_cast<int64_t>(num_threads) * lookups_per_thread, found.load());
+    return num_threads * lookups_per_thread / elapsed.count() / 1e6;
+  };
+
+  printf("%8s %16s %16s\n", "threads", "mutex+map Mops/s", "page table Mops/s");
+  for (int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+    double locked = run(num_threads, false);
+    double latch_free = run(num_threads, true);
+    printf("%8d %16.2f %16.2f\n", num_threads, locked, latch_free);
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,115 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena_test.cpp
+//
+// Identification: test/buffer/frame_arena_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "buffer/frame_arena.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, SampleTest) {
+  const size_t num_frames = 100;
+  FrameArena arena(num_frames);
+  EXPECT_EQ(num_frames, arena.GetNumFrames());
+  EXPECT_FALSE(arena.IsNumaBound());
+
+  // Scenario: frames are contiguous, page aligned and start out zeroed.
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(arena.FrameData(0)) % PAGE_SIZE);
+  for (size_t i = 1; i < num_frames; ++i) {
+    EXPECT_EQ(arena.FrameData(i - 1) + PAGE_SIZE, arena.FrameData(i));
+  }
+  char zeros[PAGE_SIZE] = {};
+  EXPECT_EQ(0, memcmp(zeros, arena.FrameData(num_frames - 1), PAGE_SIZE));
+
+  // Scenario: bound pages see the arena memory.
+  auto *pages = new Page[num_frames];
+  arena.BindPages(pages);
+  for (size_t i = 0; i < num_frames; ++i) {
+    EXPECT_EQ(arena.FrameData(i), pages[i].GetData());
+    snprintf(pages[i].GetData(), PAGE_SIZE, "frame %zu", i);
+  }
+  EXPECT_EQ(0, strcmp(arena.FrameData(42), "frame 42"));
+
+  // Scenario: released frames read as zeroes, their neighbours keep their data.
+  EXPECT_EQ(10 * PAGE_SIZE, arena.ReleaseFrames(40, 10));
+  EXPECT_EQ(0, memcmp(zeros, arena.FrameData(42), PAGE_SIZE));
+  EXPECT_EQ(0, strcmp(arena.FrameData(39), "frame 39"));
+  EXPECT_EQ(0, strcmp(arena.FrameData(50), "frame 50"));
+  snprintf(pages[42].GetData(), PAGE_SIZE, "frame %d", 42);
+  EXPECT_EQ(0, strcmp(arena.FrameData(42), "frame 42"));
+  delete[] pages;
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, HugePageAndNumaTest) {
+  // Huge pages and NUMA binding are best effort; whatever the machine offers, the arena must be usable.
+  const size_t num_frames = 1000;
+  FrameArenaOptions options;
+  options.use_huge_pages = true;
+  options.numa_node = 0;
+  FrameArena arena(num_frames, options);
+  printf("huge pages: %s, numa bound: %s, numa nodes: %d\n", arena.IsHugePageBacked() ? "yes" : "no",
+         arena.IsNumaBound() ? "yes" : "no", FrameArena::NumNumaNodes());
+
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(arena.FrameData(0)) % FrameArena::HUGE_PAGE_SIZE);
+  for (size_t i = 0; i < num_frames; ++i) {
+    memset(arena.FrameData(i), static_cast<int>(i), PAGE_SIZE);
+  }
+  EXPECT_EQ(static_cast<char>(999), arena.FrameData(999)[PAGE_SIZE - 1]);
+  EXPECT_GE(FrameArena::NumNumaNodes(), 1);
+
+  // A node that does not exist is ignored rather than failing the allocation.
+  options.numa_node = 1000;
+  FrameArena no_such_node(1, options);
+  EXPECT_FALSE(no_such_node.IsNumaBound());
+  no_such_node.FrameData(0)[0] = 1;
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, RandomAccessBenchmark) {
+  // Touch one cache line in random frames of a 128 MB pool: with 4 KB pages almost every access misses the TLB.
+  // Numbers are printed, not asserted.
+  const size_t num_frames = 32768;
+  const size_t num_accesses = 4000000;
+  std::mt19937 rng(15445);
+  std::vector<uint32_t> frames(num_accesses);
+  for (auto &f : frames) {
+    f = rng() % num_frames;
+  }
+  printf("%12s %10s %12s\n", "arena", "huge", "Maccess/s");
+  for (bool huge : {false, true}) {
+    FrameArenaOptions options;
+    options.use_huge_pages = huge;
+    FrameArena arena(num_frames, options);
+    for (size_t i = 0; i < num_frames; ++i) {
+      arena.FrameData(i)[0] = 1;
+    }
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_accesses; ++i) {
+      sum += arena.FrameData(frames[i])[(i * 64) % PAGE_SIZE];
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%12s %10s %12.2f\n", huge ? "huge pages" : "4 KB pages", arena.IsHugePageBacked() ? "yes" : "no",
+           num_accesses / elapsed.count() / 1e6);
+    EXPECT_GT(sum, 0);
+  }
+}
+
+}  // namespace bustub
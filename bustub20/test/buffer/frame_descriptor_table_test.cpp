@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_descriptor_table_test.cpp
+//
+// Identification: test/buffer/frame_descriptor_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/frame_descriptor_table.h"
+#include "gtest/gtest.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(FrameDescriptorTableTest, SampleTest) {
+  const size_t num_frames = 130;
+  FrameDescriptorTable table(num_frames);
+  EXPECT_EQ(num_frames, table.GetNumFrames());
+
+  // Scenario: every frame starts out free.
+  for (size_t i = 0; i < num_frames; ++i) {
+    auto fid = static_cast<frame_id_t>(i);
+    EXPECT_EQ(INVALID_PAGE_ID, table.GetPageId(fid));
+    EXPECT_EQ(0, table.GetPinCount(fid));
+    EXPECT_FALSE(table.IsDirty(fid));
+    EXPECT_FALSE(table.IsReferenced(fid));
+  }
+  EXPECT_EQ(-1, table.FindDirty(0));
+
+  // Scenario: bound pages report the metadata of their frame.
+  auto *pages = new Page[num_frames];
+  table.BindPages(pages);
+  table.Reset(64, 7);
+  EXPECT_EQ(1, table.PinCountUp(64));
+  EXPECT_EQ(2, table.PinCountUp(64));
+  table.SetDirty(64, true);
+  EXPECT_EQ(7, pages[64].GetPageId());
+  EXPECT_EQ(2, pages[64].GetPinCount());
+  EXPECT_TRUE(pages[64].IsDirty());
+  EXPECT_FALSE(pages[63].IsDirty());
+  EXPECT_FALSE(pages[65].IsDirty());
+  EXPECT_EQ(1, table.PinCountDown(64));
+
+  // Scenario: the dirty bitmap scan crosses word boundaries and stops at the last frame.
+  table.SetDirty(3, true);
+  table.SetDirty(129, true);
+  EXPECT_EQ(3, table.FindDirty(0));
+  EXPECT_EQ(64, table.FindDirty(4));
+  EXPECT_EQ(129, table.FindDirty(65));
+  EXPECT_EQ(-1, table.FindDirty(130));
+  table.SetDirty(64, false);
+  EXPECT_EQ(129, table.FindDirty(4));
+
+  // Scenario: reference bits are cleared by the sweep that tests them.
+  table.SetReferenced(5);
+  EXPECT_TRUE(table.TestAndClearReferenced(5));
+  EXPECT_FALSE(table.TestAndClearReferenced(5));
+
+  // Scenario: Reset gives a clean, unreferenced frame and keeps the pin count.
+  table.SetReferenced(64);
+  table.Reset(64, INVALID_PAGE_ID);
+  EXPECT_EQ(INVALID_PAGE_ID, pages[64].GetPageId());
+  EXPECT_EQ(1, pages[64].GetPinCount());
+  EXPECT_FALSE(table.IsReferenced(64));
+
+  // Scenario: claimed frames cannot be pinned, pinned frames cannot be claimed.
+  int pin_count;
+  EXPECT_FALSE(table.TryClaim(64));
+  EXPECT_TRUE(table.TryUnpin(64, &pin_count));
+  EXPECT_EQ(0, pin_count);
+  EXPECT_FALSE(table.TryUnpin(64, &pin_count));
+  EXPECT_TRUE(table.TryClaim(64));
+  EXPECT_FALSE(table.TryClaim(64));
+  EXPECT_FALSE(table.TryPin(64));
+  EXPECT_FALSE(table.TryUnpin(64, &pin_count));
+  table.SetPinCount(64, 0);
+  EXPECT_TRUE(table.TryPin(64));
+  EXPECT_EQ(1, pages[64].GetPinCount());
+  delete[] pages;
+}
+
+// NOLINTNEXTLINE
+TEST(FrameDescriptorTableTest, ConcurrentPinTest) {
+  // Pins and dirty bits of neighbouring frames share words and cache lines; no update may get lost.
+  const size_t num_frames = 64;
+  const int num_threads = 8;
+  const int rounds = 10000;
+  FrameDescriptorTable table(num_frames);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&table, t] {
+      for (int i = 0; i < rounds; ++i) {
+        for (size_t f = 0; f < num_frames; ++f) {
+          auto fid = static_cast<frame_id_t>(f);
+          table.PinCountUp(fid);
+          if (static_cast<size_t>(t) == f % num_threads) {
+            table.SetDirty(fid, true);
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t f = 0; f < num_frames; ++f) {
+    EXPECT_EQ(num_threads * rounds, table.GetPinCount(static_cast<frame_id_t>(f)));
+    EXPECT_TRUE(table.IsDirty(static_cast<frame_id_t>(f)));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(FrameDescriptorTableTest, DirtySweepBenchmark) {
+  // Find the dirty frames of a 100k frame pool where 1% of the frames are dirty: once by reading every Page, once by
+  // scanning the dirty bitmap. Numbers are printed, not asserted.
+  const size_t num_frames = 100000;
+  const int sweeps = 100;
+  FrameDescriptorTable table(num_frames);
+  auto *pages = new Page[num_frames];
+  table.BindPages(pages);
+  for (size_t i = 0; i < num_frames; i += 100) {
+    table.SetDirty(static_cast<frame_id_t>(i), true);
+  }
+
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int s = 0; s < sweeps; ++s) {
+    for (size_t i = 0; i < num_frames; ++i) {
+      found += pages[i].IsDirty() ? 1 : 0;
+    }
+  }
+  std::chrono::duration<double> per_page = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int s = 0; s < sweeps; ++s) {
+    for (auto fid = table.FindDirty(0); fid >= 0; fid = table.FindDirty(fid + 1)) {
+      found++;
+    }
+  }
+  std::chrono::duration<double> bitmap = std::chrono::steady_clock::now() - start;
+
+  printf("%12s %12s\n", "sweep", "us/sweep");
+  printf("%12s %12.1f\n", "per page", per_page.count() / sweeps * 1e6);
+  printf("%12s %12.1f\n", "bitmap", bitmap.count() / sweeps * 1e6);
+  EXPECT_EQ(2 * sweeps * num_frames / 100, found);
+  delete[] pages;
+}
+
+}  // namespace bustub
@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// intrusive_lru_replacer_test.cpp
+//
+// Identification: test/buffer/intrusive_lru_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "buffer/intrusive_lru_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(IntrusiveLRUReplacerTest, SampleTest) {
+  IntrusiveLRUReplacer lru_replacer(7);
+
+  // Scenario: unpin six elements, i.e. add them to the replacer.
+  lru_replacer.Unpin(1);
+  lru_replacer.Unpin(2);
+  lru_replacer.Unpin(3);
+  lru_replacer.Unpin(4);
+  lru_replacer.Unpin(5);
+  lru_replacer.Unpin(6);
+  lru_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_replacer.Size());
+
+  // Scenario: get three victims from the lru.
+  int value;
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+
+  // Scenario: pin elements in the replacer.
+  // Note that 3 has already been victimized, so pinning 3 should have no effect.
+  lru_replacer.Pin(3);
+  lru_replacer.Pin(4);
+  EXPECT_EQ(2, lru_replacer.Size());
+
+  // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
+  lru_replacer.Unpin(4);
+
+  // Scenario: the eviction order lists the next victim first.
+  std::vector<frame_id_t> order;
+  lru_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{5, 6, 4}), order);
+
+  // Scenario: continue looking for victims. We expect these victims.
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_replacer.Size());
+}
+
+/** Random Pin/Unpin/Victim mix over all frames, the same op sequence for every replacer. */
+static std::vector<int> MakeOps(size_t num_frames, size_t num_ops) {
+  std::mt19937 rng(15445);
+  std::vector<int> ops(num_ops);
+  for (auto &op : ops) {
+    op = static_cast<int>(rng() % (num_frames * 3));
+  }
+  return ops;
+}
+
+static double RunOps(Replacer *replacer, size_t num_frames, const std::vector<int> &ops, std::vector<int> *victims) {
+  auto start = std::chrono::steady_clock::now();
+  for (int op : ops) {
+    auto frame_id = static_cast<frame_id_t>(op % num_frames);
+    switch (op / num_frames) {
+      case 0:
+        replacer->Pin(frame_id);
+        break;
+      case 1:
+        replacer->Unpin(frame_id);
+        break;
+      default:
+        if (replacer->Victim(&frame_id)) {
+          victims->push_back(frame_id);
+        }
+        break;
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return ops.size() / elapsed.count() / 1e6;
+}
+
+// NOLINTNEXTLINE
+TEST(IntrusiveLRUReplacerTest, CompareWithLRUReplacerBenchmark) {
+  // Both replacers must pick exactly the same victims; throughput is printed, not asserted.
+  printf("%10s %14s %14s\n", "frames", "list Mops/s", "intrusive Mops/s");
+  for (size_t num_frames : {64, 4096, 65536}) {
+    auto ops = MakeOps(num_frames, 1000000);
+    LRUReplacer list_replacer(num_frames);
+    IntrusiveLRUReplacer intrusive_replacer(num_frames);
+    std::vector<int> list_victims;
+    std::vector<int> intrusive_victims;
+    double list_mops = RunOps(&list_replacer, num_frames, ops, &list_victims);
+    double intrusive_mops = RunOps(&intrusive_replacer, num_frames, ops, &intrusive_victims);
+    printf("%10zu %14.2f %14.2f\n", num_frames, list_mops, intrusive_mops);
+
+    EXPECT_EQ(list_victims, intrusive_victims);
+    EXPECT_EQ(list_replacer.Size(), intrusive_replacer.Size());
+  }
+}
+
+}  // namespace bustub
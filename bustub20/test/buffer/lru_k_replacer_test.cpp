@@ -0,0 +1,304 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: frames 1-4 are accessed twice, frames 5 and 6 only once.
+  for (int round = 0; round < 2; round++) {
+    for (int i = 1; i <= 4; i++) {
+      lru_k_replacer.Unpin(i);
+      lru_k_replacer.Pin(i);
+    }
+  }
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Unpin(6);
+  for (int i = 1; i <= 4; i++) {
+    lru_k_replacer.Unpin(i);
+  }
+  // Unpinning an evictable frame again is not an access.
+  lru_k_replacer.Unpin(6);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: the eviction order is the order Victim picks in.
+  std::vector<frame_id_t> order;
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{5, 6, 1, 2, 3, 4}), order);
+
+  // Scenario: frames with fewer than k accesses go first, even though they were touched last.
+  int value;
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(5, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(6, value);
+
+  // Scenario: then by oldest second-to-last access. Frame 1 is pinned, so 2 goes.
+  lru_k_replacer.Pin(1);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(2, value);
+
+  // Scenario: frame 1 is unpinned again. Its two latest accesses are now more recent than those of 3 and 4.
+  lru_k_replacer.Unpin(1);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(3, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(4, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+
+  // Scenario: a victimized frame keeps its history until it is removed; unpinned again, it is as hot as before.
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Unpin(3);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Remove(1);
+  lru_k_replacer.Remove(2);
+  lru_k_replacer.Remove(4);
+
+  // Scenario: a removed frame starts over with an empty history.
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Pin(2);
+  lru_k_replacer.Unpin(2);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, RecordAccessTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+  for (int i = 1; i <= 3; i++) {
+    lru_k_replacer.Unpin(i);
+  }
+
+  // Scenario: an access to an evictable frame counts without Pin and Unpin; frame 2 now has its k accesses.
+  EXPECT_TRUE(lru_k_replacer.RecordAccess(2));
+  std::vector<frame_id_t> order;
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3, 2}), order);
+
+  // Scenario: the Unpin after such an access adds nothing, the frame is still evictable.
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3, 2}), order);
+
+  // Scenario: an access to a frame outside the replacer is left to its Unpin, so it is not counted twice.
+  lru_k_replacer.Pin(3);
+  EXPECT_TRUE(lru_k_replacer.RecordAccess(3));
+  lru_k_replacer.Unpin(3);
+  // Frame 1 has its second access now, but its first one is still the oldest.
+  EXPECT_TRUE(lru_k_replacer.RecordAccess(1));
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 2, 3}), order);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: Victim counts a hit that no other call has taken in yet; frame 4 has its k accesses, frame 5 does not.
+  LRUKReplacer hit_replacer(7, 2);
+  hit_replacer.Unpin(4);
+  hit_replacer.Unpin(5);
+  EXPECT_TRUE(hit_replacer.RecordAccess(4));
+  frame_id_t victim;
+  EXPECT_TRUE(hit_replacer.Victim(&victim));
+  EXPECT_EQ(5, victim);
+
+  // Scenario: hits that come before the replacer takes them in count as one access.
+  LRUKReplacer collapse_replacer(7, 3);
+  collapse_replacer.Unpin(1);
+  collapse_replacer.Unpin(2);
+  EXPECT_TRUE(collapse_replacer.RecordAccess(1));
+  EXPECT_TRUE(collapse_replacer.RecordAccess(1));
+  EXPECT_TRUE(collapse_replacer.Victim(&victim));
+  EXPECT_EQ(1, victim);
+
+  // Scenario: replacers that only know unpin order leave the access to the caller.
+  LRUReplacer lru_replacer(7);
+  lru_replacer.Unpin(1);
+  EXPECT_FALSE(lru_replacer.RecordAccess(1));
+}
+
+/**
+ * Replays a page access trace against a replacer the same way the buffer pool drives it
+ * (free frames first, Pin on hit, Unpin after every access) and returns the hit ratio.
+ */
+static double ReplayTrace(Replacer *replacer, size_t num_frames, const std::vector<page_id_t> &trace) {
+  std::unordered_map<page_id_t, frame_id_t> page_table;
+  std::vector<page_id_t> frame_to_page(num_frames, INVALID_PAGE_ID);
+  std::list<frame_id_t> free_list;
+  for (size_t i = 0; i < num_frames; i++) {
+    free_list.push_back(static_cast<frame_id_t>(i));
+  }
+
+  size_t hits = 0;
+  for (page_id_t page_id : trace) {
+    frame_id_t frame_id;
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      hits++;
+      frame_id = it->second;
+      replacer->Pin(frame_id);
+    } else {
+      if (!free_list.empty()) {
+        frame_id = free_list.front();
+        free_list.pop_front();
+      } else {
+        EXPECT_TRUE(replacer->Victim(&frame_id));
+        replacer->Remove(frame_id);
+        page_table.erase(frame_to_page[frame_id]);
+      }
+      frame_to_page[frame_id] = page_id;
+      page_table[page_id] = frame_id;
+    }
+    replacer->Unpin(frame_id);
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, RemoveTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+  // frame 3 is accessed twice first, then frame 1
+  for (frame_id_t frame_id : {3, 1}) {
+    lru_k_replacer.Unpin(frame_id);
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+  std::vector<frame_id_t> order;
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{3, 1}), order);
+
+  // Scenario: frame 1 goes back to the free list and gets a new page; the page starts with one access, before frame 3.
+  lru_k_replacer.Remove(1);
+  EXPECT_EQ(1, lru_k_replacer.Size());
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3}), order);
+
+  // Scenario: removing a frame that is pinned, i.e. not in the replacer, drops its history as well.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Remove(3);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3}), order);
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{1, 3, 5}), order);
+}
+
+/**
+ * Replays a page access trace the way BufferPoolManagerInstance drives its replacer since hits stopped latching: a hit
+ * pins the frame without taking it out of the replacer and only calls RecordAccess; if the replacer leaves the access
+ * to the caller, the frame gets a reference bit, and eviction puts referenced victims back once. Returns the hit ratio.
+ */
+static double ReplayTraceWithLatchFreeHits(Replacer *replacer, size_t num_frames,
+                                           const std::vector<page_id_t> &trace) {
+  std::unordered_map<page_id_t, frame_id_t> page_table;
+  std::vector<page_id_t> frame_to_page(num_frames, INVALID_PAGE_ID);
+  std::vector<bool> referenced(num_frames, false);
+  std::list<frame_id_t> free_list;
+  for (size_t i = 0; i < num_frames; i++) {
+    free_list.push_back(static_cast<frame_id_t>(i));
+  }
+
+  size_t hits = 0;
+  for (page_id_t page_id : trace) {
+    frame_id_t frame_id;
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      hits++;
+      frame_id = it->second;
+      if (!replacer->RecordAccess(frame_id)) {
+        referenced[frame_id] = true;
+      }
+    } else {
+      if (!free_list.empty()) {
+        frame_id = free_list.front();
+        free_list.pop_front();
+      } else {
+        size_t second_chances = 0;
+        while (true) {
+          EXPECT_TRUE(replacer->Victim(&frame_id));
+          if (second_chances < num_frames && referenced[frame_id]) {
+            second_chances++;
+            referenced[frame_id] = false;
+            replacer->Unpin(frame_id);
+            continue;
+          }
+          break;
+        }
+        replacer->Remove(frame_id);
+        page_table.erase(frame_to_page[frame_id]);
+      }
+      frame_to_page[frame_id] = page_id;
+      page_table[page_id] = frame_id;
+    }
+    replacer->Unpin(frame_id);
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  // Trace: point lookups on a hot set that fits in the pool, interrupted by full sequential scans of a table several
+  // times larger than the pool.
+  const size_t num_frames = 64;
+  const page_id_t hot_pages = 48;
+  const page_id_t table_pages = 256;
+  std::mt19937 rng(15445);
+  std::uniform_int_distribution<page_id_t> hot(0, hot_pages - 1);
+
+  std::vector<page_id_t> trace;
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < 300; i++) {
+      trace.push_back(hot(rng));
+    }
+    for (page_id_t p = 0; p < table_pages; p++) {
+      trace.push_back(hot_pages + p);
+    }
+  }
+
+  LRUReplacer lru(num_frames);
+  LRUKReplacer lru_2(num_frames, 2);
+  double lru_ratio = ReplayTrace(&lru, num_frames, trace);
+  double lru_2_ratio = ReplayTrace(&lru_2, num_frames, trace);
+  printf("hit ratio with %zu frames: LRU %.3f, LRU-2 %.3f\n", num_frames, lru_ratio, lru_2_ratio);
+
+  // Each scan wipes out the hot set under LRU; LRU-2 keeps it resident.
+  EXPECT_GT(lru_2_ratio, lru_ratio + 0.05);
+
+  // Scenario: the same holds when hits only reach the replacer through RecordAccess, as in the latch-free hit path.
+  LRUReplacer clock_lru(num_frames);
+  LRUKReplacer latch_free_lru_2(num_frames, 2);
+  double clock_ratio = ReplayTraceWithLatchFreeHits(&clock_lru, num_frames, trace);
+  double latch_free_lru_2_ratio = ReplayTraceWithLatchFreeHits(&latch_free_lru_2, num_frames, trace);
+  printf("with latch-free hits: LRU + reference bits %.3f, LRU-2 %.3f\n", clock_ratio, latch_free_lru_2_ratio);
+  EXPECT_GT(latch_free_lru_2_ratio, clock_ratio + 0.05);
+  EXPECT_NEAR(lru_2_ratio, latch_free_lru_2_ratio, 0.01);
+}
+
+}  // namespace bustub
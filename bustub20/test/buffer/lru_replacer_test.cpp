@@ -50,6 +50,11 @@ printf("test1ok");
   // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
   lru_replacer.Unpin(4);
 
+  // Scenario: the eviction order lists the next victim first.
+  std::vector<frame_id_t> order;
+  lru_replacer.EvictionOrder(&order);
+  EXPECT_EQ((std::vector<frame_id_t>{5, 6, 4}), order);
+
   // Scenario: continue looking for victims. We expect these victims.
   lru_replacer.Victim(&value);
   EXPECT_EQ(5, value);
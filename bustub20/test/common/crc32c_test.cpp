@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c_test.cpp
+//
+// Identification: test/common/crc32c_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/config.h"
+#include "common/util/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, SampleTest) {
+  // Scenario: the check values of the CRC-32C catalogue and RFC 3720.
+  const char *digits = "123456789";
+  EXPECT_EQ(0xe3069283, Crc32c::Checksum(digits, strlen(digits)));
+  EXPECT_EQ(0xe3069283, Crc32c::ChecksumSoftware(digits, strlen(digits)));
+  std::vector<char> zeros(32, 0);
+  EXPECT_EQ(0x8a9136aa, Crc32c::Checksum(zeros.data(), zeros.size()));
+  std::vector<char> ones(32, static_cast<char>(0xff));
+  EXPECT_EQ(0x62a8ab43, Crc32c::Checksum(ones.data(), ones.size()));
+  EXPECT_EQ(0, Crc32c::Checksum(nullptr, 0));
+
+  // Scenario: every length and misalignment through the three-stream loops agrees with the table.
+  std::mt19937 gen(15445);
+  std::vector<char> data(3 * PAGE_SIZE);
+  for (auto &byte : data) {
+    byte = static_cast<char>(gen());
+  }
+  for (size_t length : {1, 7, 8, 767, 768, 769, 3071, 3072, 3073, 4096, 4097, 3 * 4096}) {
+    for (size_t offset = 0; offset < 8 && offset + length <= data.size(); offset += 3) {
+      EXPECT_EQ(Crc32c::ChecksumSoftware(data.data() + offset, length), Crc32c::Checksum(data.data() + offset, length))
+          << "length " << length << " offset " << offset;
+    }
+  }
+
+  // Scenario: a buffer can be checksummed in pieces.
+  uint32_t crc = Crc32c::Checksum(data.data(), 1000);
+  EXPECT_EQ(Crc32c::Checksum(data.data(), PAGE_SIZE), Crc32c::Checksum(data.data() + 1000, PAGE_SIZE - 1000, crc));
+
+  // Scenario: a single flipped bit changes the checksum.
+  uint32_t before = Crc32c::Checksum(data.data(), PAGE_SIZE);
+  data[1234] ^= 0x10;
+  EXPECT_NE(before, Crc32c::Checksum(data.data(), PAGE_SIZE));
+}
+
+// NOLINTNEXTLINE
+TEST(Crc32cTest, PageBenchmark) {
+  // Checksum one 4 KB page over and over. Numbers are printed, not asserted.
+  const int rounds = 100000;
+  std::vector<char> page(PAGE_SIZE, 'x');
+  uint32_t sink = 0;
+  printf("%10s %10s\n", "crc32c", "ns/page");
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    sink ^= Crc32c::Checksum(page.data(), PAGE_SIZE, sink);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("%10s %10.1f\n", Crc32c::HasHardwareSupport() ? "sse4.2" : "table", elapsed.count() / rounds * 1e9);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds / 10; i++) {
+    sink ^= Crc32c::ChecksumSoftware(page.data(), PAGE_SIZE, sink);
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  printf("%10s %10.1f\n", "table", elapsed.count() / (rounds / 10) * 1e9);
+  EXPECT_NE(0, sink | 1);
+}
+
+}  // namespace bustub
@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz4_test.cpp
+//
+// Identification: test/common/lz4_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/util/lz4.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+/** Compress, check the size, decompress and compare. */
+size_t RoundTrip(const std::vector<char> &data) {
+  std::vector<char> compressed(data.size() + data.size() / 255 + 16);
+  size_t size = Lz4::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+  EXPECT_NE(0, size);
+  std::vector<char> restored(data.size());
+  EXPECT_TRUE(Lz4::Decompress(compressed.data(), size, restored.data(), restored.size()));
+  EXPECT_EQ(data, restored);
+  return size;
+}
+
+/** A page laid out like a table page: a header, a slot array and tuples of a few columns with small values. */
+std::vector<char> TablePage(std::mt19937 *gen) {
+  std::vector<char> page(PAGE_SIZE, 0);
+  int32_t num_tuples = 200;
+  for (int32_t i = 0; i < num_tuples; i++) {
+    int32_t tuple_offset = PAGE_SIZE - (i + 1) * 16;
+    int32_t slot[2] = {tuple_offset, 16};
+    memcpy(page.data() + 24 + i * 8, slot, sizeof(slot));
+    int32_t values[4] = {i, static_cast<int32_t>((*gen)() % 10), static_cast<int32_t>((*gen)() % 100), 7};
+    memcpy(page.data() + tuple_offset, values, sizeof(values));
+  }
+  return page;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(Lz4Test, SampleTest) {
+  std::mt19937 gen(15445);
+
+  // Scenario: empty and tiny inputs are all literals.
+  std::vector<char> compressed(64);
+  EXPECT_EQ(1, Lz4::Compress(nullptr, 0, compressed.data(), compressed.size()));
+  EXPECT_TRUE(Lz4::Decompress(compressed.data(), 1, nullptr, 0));
+  for (size_t length : {1, 5, 12, 13, 20}) {
+    RoundTrip(std::vector<char>(length, 'a'));
+  }
+
+  // Scenario: a zeroed page shrinks to a few bytes, a table page by about 40%.
+  EXPECT_GT(64, RoundTrip(std::vector<char>(PAGE_SIZE, 0)));
+  EXPECT_GT(PAGE_SIZE * 3 / 5, RoundTrip(TablePage(&gen)));
+
+  // Scenario: long literal and match runs need length extension bytes.
+  std::vector<char> runs(3 * PAGE_SIZE);
+  for (size_t i = 0; i < runs.size(); i++) {
+    runs[i] = (i / 1000) % 2 == 0 ? static_cast<char>(gen()) : 'z';
+  }
+  RoundTrip(runs);
+
+  // Scenario: random bytes do not compress; they round-trip when there is room and fail cleanly when there is not.
+  std::vector<char> noise(PAGE_SIZE);
+  for (auto &byte : noise) {
+    byte = static_cast<char>(gen());
+  }
+  EXPECT_LT(PAGE_SIZE, RoundTrip(noise));
+  EXPECT_EQ(0, Lz4::Compress(noise.data(), noise.size(), compressed.data(), compressed.size()));
+
+  // Scenario: inputs past the window are refused.
+  std::vector<char> big(Lz4::MAX_INPUT_SIZE + 1, 'a');
+  EXPECT_EQ(0, Lz4::Compress(big.data(), big.size(), compressed.data(), compressed.size()));
+
+  // Scenario: a hand-built block in the reference format for "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab" decodes.
+  const char block[] = {0x1f, 'a', 0x01, 0x00, 0x07, 0x50, 'a', 'a', 'a', 'a', 'b'};
+  std::string expected = std::string(31, 'a') + "b";
+  std::vector<char> out(expected.size());
+  ASSERT_TRUE(Lz4::Decompress(block, sizeof(block), out.data(), out.size()));
+  EXPECT_EQ(expected, std::string(out.begin(), out.end()));
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4Test, MalformedTest) {
+  std::mt19937 gen(15445);
+  std::vector<char> page = TablePage(&gen);
+  std::vector<char> compressed(PAGE_SIZE * 2);
+  size_t size = Lz4::Compress(page.data(), page.size(), compressed.data(), compressed.size());
+  ASSERT_NE(0, size);
+  std::vector<char> out(PAGE_SIZE);
+
+  // Scenario: the wrong output size is rejected, in both directions.
+  EXPECT_FALSE(Lz4::Decompress(compressed.data(), size, out.data(), PAGE_SIZE - 1));
+  std::vector<char> larger(PAGE_SIZE + 1);
+  EXPECT_FALSE(Lz4::Decompress(compressed.data(), size, larger.data(), larger.size()));
+
+  // Scenario: every truncation is rejected.
+  for (size_t length = 0; length < size; length++) {
+    EXPECT_FALSE(Lz4::Decompress(compressed.data(), length, out.data(), out.size())) << "length " << length;
+  }
+
+  // Scenario: an offset reaching before the start of the output is rejected.
+  const char before_start[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  EXPECT_FALSE(Lz4::Decompress(before_start, sizeof(before_start), out.data(), 5));
+  const char zero_offset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+  EXPECT_FALSE(Lz4::Decompress(zero_offset, sizeof(zero_offset), out.data(), 5));
+
+  // Scenario: garbage never crashes and never decodes into a wrong-sized page.
+  for (int round = 0; round < 1000; round++) {
+    std::vector<char> garbage(compressed.begin(), compressed.begin() + size);
+    for (int flips = 0; flips < 4; flips++) {
+      garbage[gen() % size] = static_cast<char>(gen());
+    }
+    Lz4::Decompress(garbage.data(), garbage.size(), out.data(), out.size());
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(Lz4Test, PageBenchmark) {
+  // Compress and decompress table pages over and over. Numbers are printed, not asserted.
+  const int rounds = 20000;
+  std::mt19937 gen(15445);
+  std::vector<char> page = TablePage(&gen);
+  std::vector<char> compressed(PAGE_SIZE * 2);
+  std::vector<char> out(PAGE_SIZE);
+  size_t size = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    size = Lz4::Compress(page.data(), page.size(), compressed.data(), compressed.size());
+  }
+  std::chrono::duration<double> compress = std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) {
+    Lz4::Decompress(compressed.data(), size, out.data(), out.size());
+  }
+  std::chrono::duration<double> decompress = std::chrono::steady_clock::now() - start;
+  printf("%10s %12s %12s\n", "ratio", "comp MB/s", "decomp MB/s");
+  printf("%10.2f %12.0f %12.0f\n", static_cast<double>(PAGE_SIZE) / size,
+         static_cast<double>(rounds) * PAGE_SIZE / compress.count() / 1e6,
+         static_cast<double>(rounds) * PAGE_SIZE / decompress.count() / 1e6);
+  EXPECT_EQ(page, out);
+}
+
+}  // namespace bustub
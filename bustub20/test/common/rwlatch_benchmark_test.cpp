@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// rwlatch_benchmark_test.cpp
+//
+// Identification: test/common/rwlatch_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "common/rwlatch.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+/**
+ * Hammer one latch from num_threads threads. Critical sections are about as long as a page latch is held: writers
+ * shift a few bytes of a page, readers sum a few bytes of it.
+ * @param read_percent share of the operations that take the read latch
+ * @return million latch acquisitions per second
+ */
+template <typename Latch>
+double RunContention(int num_threads, int read_percent) {
+  const int total_ops = 400000;
+  const int ops_per_thread = total_ops / num_threads;
+  Latch latch;
+  char page[PAGE_SIZE] = {};
+  int64_t writes = 0;
+  std::atomic<uint64_t> checksum{0};
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      uint64_t sum = 0;
+      for (int i = 0; i < ops_per_thread; i++) {
+        if ((i * 7 + t) % 100 < read_percent) {
+          latch.RLock();
+          for (int j = 0; j < 64; j += 8) {
+            sum += page[(i + j) % PAGE_SIZE];
+          }
+          latch.RUnlock();
+        } else {
+          latch.WLock();
+          memmove(page + 1, page, 63);
+          page[0] = static_cast<char>(i);
+          writes++;
+          latch.WUnlock();
+        }
+      }
+      // 防止读路径被优化掉
+      checksum += sum;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(read_percent == 100, writes == 0);
+  return static_cast<double>(ops_per_thread) * num_threads / elapsed.count() / 1e6;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(RWLatchBenchmarkTest, ContentionBenchmark) {
+  // Throughput of the mutex backed latch and the spin-then-park latch from 1 to 64 threads, for a write-only and a
+  // read-mostly mix. Numbers depend on the core count of the machine and are printed, not asserted.
+  printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  printf("%8s %8s %14s %14s\n", "threads", "reads %", "mutex Mops/s", "hybrid Mops/s");
+  for (int read_percent : {0, 90}) {
+    for (int num_threads : {1, 2, 4, 8, 16, 32, 64}) {
+      double mutex = RunContention<ReaderWriterLatch>(num_threads, read_percent);
+      double hybrid = RunContention<HybridReaderWriterLatch>(num_threads, read_percent);
+      printf("%8d %8d %14.2f %14.2f\n", num_threads, read_percent, mutex, hybrid);
+    }
+  }
+}
+
+}  // namespace bustub
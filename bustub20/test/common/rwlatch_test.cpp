@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -18,9 +20,11 @@
 
 namespace bustub {
 
+template <typename Latch = ReaderWriterLatch>
 class Counter {
  public:
   Counter() = default;
+  explicit Counter(bool prefer_writers) : mutex(prefer_writers) {}
   void Add(int num) {
     mutex.WLock();
     count_ += num;
@@ -36,13 +40,13 @@ class Counter {
 
  private:
   int count_{0};
-  ReaderWriterLatch mutex{};
+  Latch mutex{};
 };
 
 // NOLINTNEXTLINE
 TEST(RWLatchTest, BasicTest) {
   int num_threads = 100;
-  Counter counter{};
+  Counter<> counter{};
   counter.Add(5);
   std::vector<std::thread> threads;
   for (int tid = 0; tid < num_threads; tid++) {
@@ -57,4 +61,61 @@ TEST(RWLatchTest, BasicTest) {
   }
   EXPECT_EQ(counter.Read(), 55);
 }
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, HybridBasicTest) {
+  for (bool prefer_writers : {true, false}) {
+    int num_threads = 100;
+    Counter<HybridReaderWriterLatch> counter{prefer_writers};
+    counter.Add(5);
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      if (tid % 2 == 0) {
+        threads.emplace_back([&counter]() { counter.Read(); });
+      } else {
+        threads.emplace_back([&counter]() {
+          for (int i = 0; i < 1000; i++) {
+            counter.Add(1);
+          }
+        });
+      }
+    }
+    for (int i = 0; i < num_threads; i++) {
+      threads[i].join();
+    }
+    EXPECT_EQ(counter.Read(), 50005);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, HybridWriterPreferenceTest) {
+  // Scenario: readers share the latch, a writer waits for them and parks if they hold it long enough.
+  HybridReaderWriterLatch latch;
+  latch.RLock();
+  latch.RLock();
+  std::atomic<bool> written{false};
+  std::thread writer([&] {
+    latch.WLock();
+    written = true;
+    latch.WUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(written);
+
+  // Scenario: while the writer waits, a new reader has to wait behind it.
+  std::atomic<bool> read{false};
+  std::thread reader([&] {
+    latch.RLock();
+    EXPECT_TRUE(written);
+    read = true;
+    latch.RUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(read);
+  latch.RUnlock();
+  latch.RUnlock();
+  writer.join();
+  reader.join();
+  EXPECT_TRUE(read);
+}
 }  // namespace bustub
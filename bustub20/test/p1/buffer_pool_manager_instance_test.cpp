@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance_test.cpp
+//
+// Identification: test/p1/buffer_pool_manager_instance_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  auto *page0 = bpm->NewPage(&page_id_temp);
+
+  // Scenario: The buffer pool is empty. We should be able to create a new page.
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, page_id_temp);
+
+  // Scenario: Once we have a page, we should be able to read and write content.
+  snprintf(page0->GetData(), PAGE_SIZE, "Hello");
+  EXPECT_EQ(0, strcmp(page0->GetData(), "Hello"));
+
+  // Scenario: We should be able to create new pages until we fill up the buffer pool.
+  for (size_t i = 1; i < buffer_pool_size; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  }
+
+  // Scenario: Once the buffer pool is full, we should not be able to create any new pages, and the failed calls do
+  // not use up page ids.
+  for (size_t i = buffer_pool_size; i < buffer_pool_size * 2; ++i) {
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  }
+
+  // Scenario: After unpinning pages {0, 1, 2, 3, 4} and pinning another 4 new pages,
+  // there would still be one buffer page left for reading page 0.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, true));
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(static_cast<page_id_t>(buffer_pool_size) + i, page_id_temp);
+  }
+
+  // Scenario: We should be able to fetch the data we wrote a while ago.
+  page0 = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, strcmp(page0->GetData(), "Hello"));
+
+  // Scenario: If we unpin page 0 and then make a new page, all the buffer pages should
+  // now be pinned. Fetching page 0 should fail.
+  EXPECT_EQ(true, bpm->UnpinPage(0, true));
+  EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(nullptr, bpm->FetchPage(0));
+
+  // Shutdown the disk manager and remove the temporary file we created.
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushPageTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *log_manager = new LogManager(disk_manager);
+  enable_logging = true;
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, log_manager);
+
+  // The content goes after the page id and the LSN.
+  const size_t offset = sizeof(page_id_t) + sizeof(lsn_t);
+  page_id_t page_id_temp;
+  auto *page0 = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page0);
+  snprintf(page0->GetData() + offset, PAGE_SIZE - offset, "Hello");
+  LogRecord begin(7, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(&begin);
+  page0->SetLSN(lsn);
+  EXPECT_EQ(true, bpm->UnpinPage(0, true));
+
+  // Scenario: FlushPage writes the log up to the page's LSN before the page, then the page is clean.
+  EXPECT_EQ(true, bpm->FlushPage(0));
+  EXPECT_EQ(lsn, log_manager->GetPersistentLSN());
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(0, data);
+  EXPECT_EQ(lsn, page0->GetLSN());
+  EXPECT_EQ(0, memcmp(page0->GetData(), data, PAGE_SIZE));
+  EXPECT_FALSE(page0->IsDirty());
+
+  // Scenario: a page that is still pinned is written, but stays dirty, since it may change during the write.
+  ASSERT_EQ(page0, bpm->FetchPage(0));
+  ASSERT_EQ(page0, bpm->FetchPage(0));
+  snprintf(page0->GetData() + offset, PAGE_SIZE - offset, "World");
+  EXPECT_EQ(true, bpm->UnpinPage(0, true));
+  EXPECT_EQ(true, bpm->FlushPage(0));
+  disk_manager->ReadPage(0, data);
+  EXPECT_EQ(0, strcmp(data + offset, "World"));
+  EXPECT_TRUE(page0->IsDirty());
+
+  // Scenario: FlushAllPages cleans it once it is unpinned.
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+  bpm->FlushAllPages();
+  EXPECT_FALSE(page0->IsDirty());
+
+  enable_logging = false;
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, BulkInsertBenchmark) {
+  // Bulk load: every NewPage first checks whether all frames are pinned, then takes a frame from the free list or
+  // evicts one. Neither step may grow with the pool size, so pages/s should stay flat from 1k to 100k frames.
+  // Throughput is printed, not asserted.
+  const std::string db_name = "test.db";
+  printf("%10s %10s %14s\n", "frames", "pages", "pages/s");
+  for (size_t buffer_pool_size : {1000, 10000, 100000}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+    page_id_t page_id_temp;
+    size_t num_pages = 2 * buffer_pool_size;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_pages; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+      ASSERT_EQ(static_cast<page_id_t>(i), page_id_temp);
+      bpm->UnpinPage(page_id_temp, false);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%10zu %10zu %14.0f\n", buffer_pool_size, num_pages, num_pages / elapsed.count());
+
+    // Scenario: once every frame is pinned, NewPage fails right away, and works again after an unpin.
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    }
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+
+    disk_manager->ShutDown();
+    remove(db_name.c_str());
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+}  // namespace bustub
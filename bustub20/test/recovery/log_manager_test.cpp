@@ -0,0 +1,305 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// log_manager_test.cpp
+//
+// Identification: test/recovery/log_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "catalog/schema.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+class LogManagerTest : public ::testing::Test {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    enable_logging = false;
+    remove("test.db");
+    remove("test.log");
+  };
+};
+
+namespace {
+
+/** Header of a serialized log record. */
+struct LogHeader {
+  int32_t size;
+  lsn_t lsn;
+  txn_id_t txn_id;
+  lsn_t prev_lsn;
+  LogRecordType type;
+};
+
+/** Read the header of every log record in the log file. */
+std::vector<LogHeader> ReadHeaders(DiskManager *disk_manager) {
+  std::vector<LogHeader> headers;
+  LogHeader header;
+  int offset = 0;
+  while (disk_manager->ReadLog(reinterpret_cast<char *>(&header), sizeof(header), offset) && header.size > 0) {
+    headers.push_back(header);
+    offset += header.size;
+  }
+  return headers;
+}
+
+/** Tuples of an INTEGER and a VARCHAR column, about as large as the rows an insert-heavy workload writes. */
+class TupleMaker {
+ public:
+  TupleMaker() : schema_({Column("a", TypeId::INTEGER), Column("b", TypeId::VARCHAR, 64)}) {}
+  Tuple Make(int32_t value) {
+    return Tuple({ValueFactory::GetIntegerValue(value), ValueFactory::GetVarcharValue(std::string(40, 'x'))},
+                 &schema_);
+  }
+
+ private:
+  Schema schema_;
+};
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AppendTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+
+  // Scenario: records get consecutive LSNs and are serialized header first; nothing is on disk before a flush.
+  LogRecord begin(7, INVALID_LSN, LogRecordType::BEGIN);
+  EXPECT_EQ(0, log_manager.AppendLogRecord(&begin));
+  LogRecord new_page(7, 0, LogRecordType::NEWPAGE, INVALID_PAGE_ID, 3);
+  EXPECT_EQ(1, log_manager.AppendLogRecord(&new_page));
+  LogRecord commit(7, 1, LogRecordType::COMMIT);
+  EXPECT_EQ(2, log_manager.AppendLogRecord(&commit));
+  EXPECT_EQ(INVALID_LSN, log_manager.GetPersistentLSN());
+  EXPECT_EQ(0, disk_manager.GetNumFlushes());
+
+  // Scenario: without a flush thread, Flush writes the log itself.
+  log_manager.Flush(1);
+  EXPECT_EQ(2, log_manager.GetPersistentLSN());
+  EXPECT_EQ(1, disk_manager.GetNumFlushes());
+  log_manager.Flush();
+  EXPECT_EQ(1, disk_manager.GetNumFlushes());
+  auto headers = ReadHeaders(&disk_manager);
+  ASSERT_EQ(3, headers.size());
+  EXPECT_EQ(LogRecordType::NEWPAGE, headers[1].type);
+  EXPECT_EQ(28, headers[1].size);
+  EXPECT_EQ(1, headers[1].lsn);
+  EXPECT_EQ(7, headers[2].txn_id);
+  EXPECT_EQ(1, headers[2].prev_lsn);
+  page_id_t page_ids[2];
+  disk_manager.ReadLog(reinterpret_cast<char *>(page_ids), sizeof(page_ids), 20 + 20);
+  EXPECT_EQ(INVALID_PAGE_ID, page_ids[0]);
+  EXPECT_EQ(3, page_ids[1]);
+
+  // Scenario: a full log buffer is written out to make room, nothing gets lost.
+  int num_records = 2 * LOG_BUFFER_SIZE / 20;
+  for (int i = 0; i < num_records; i++) {
+    LogRecord record(8, INVALID_LSN, LogRecordType::ABORT);
+    log_manager.AppendLogRecord(&record);
+  }
+  EXPECT_LE(3, disk_manager.GetNumFlushes());
+  log_manager.Flush();
+  EXPECT_EQ(num_records + 3, ReadHeaders(&disk_manager).size());
+  EXPECT_EQ(num_records + 2, log_manager.GetPersistentLSN());
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommitTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+  EXPECT_TRUE(enable_logging);
+
+  // Scenario: a committed transaction's COMMIT record is on disk when Commit returns.
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager, &log_manager);
+  Transaction *txn = txn_mgr.Begin();
+  EXPECT_EQ(0, txn->GetPrevLSN());
+  txn_mgr.Commit(txn);
+  EXPECT_EQ(1, txn->GetPrevLSN());
+  EXPECT_LE(1, log_manager.GetPersistentLSN());
+  delete txn;
+
+  // Scenario: concurrent commits all become durable, sharing writes.
+  const int num_threads = 8;
+  const int commits_per_thread = 50;
+  int flushes_before = disk_manager.GetNumFlushes();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < commits_per_thread; i++) {
+        LogRecord begin(100 + t, INVALID_LSN, LogRecordType::BEGIN);
+        lsn_t lsn = log_manager.AppendLogRecord(&begin);
+        LogRecord commit(100 + t, lsn, LogRecordType::COMMIT);
+        lsn = log_manager.AppendLogRecord(&commit);
+        log_manager.Flush(lsn);
+        EXPECT_LE(lsn, log_manager.GetPersistentLSN());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_GE(num_threads * commits_per_thread, disk_manager.GetNumFlushes() - flushes_before);
+
+  // Scenario: records appended without a commit reach the disk at the latest when the flush thread stops.
+  LogRecord abort(9, INVALID_LSN, LogRecordType::ABORT);
+  lsn_t lsn = log_manager.AppendLogRecord(&abort);
+  log_manager.StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+  EXPECT_EQ(lsn, log_manager.GetPersistentLSN());
+  EXPECT_EQ(2 + 2 * num_threads * commits_per_thread + 1, ReadHeaders(&disk_manager).size());
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, ParallelAppendTest) {
+  DiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  log_manager.RunFlushThread();
+  TupleMaker maker;
+
+  // Scenario: threads append INSERT records concurrently while the flush thread swaps buffers under them; every
+  // record reaches the log whole, and the log is in LSN order.
+  const int num_threads = 8;
+  const int records_per_thread = 2000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      Tuple tuple = maker.Make(t);
+      lsn_t prev_lsn = INVALID_LSN;
+      for (int i = 0; i < records_per_thread; i++) {
+        LogRecord insert(t, prev_lsn, LogRecordType::INSERT, RID(t, i), tuple);
+        lsn_t lsn = log_manager.AppendLogRecord(&insert);
+        EXPECT_LT(prev_lsn, lsn);
+        prev_lsn = lsn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+  EXPECT_EQ(num_threads * records_per_thread - 1, log_manager.GetPersistentLSN());
+  EXPECT_LT(1, disk_manager.GetNumFlushes());
+
+  auto headers = ReadHeaders(&disk_manager);
+  ASSERT_EQ(num_threads * records_per_thread, headers.size());
+  std::vector<int> next_slot(num_threads, 0);
+  std::vector<lsn_t> prev_lsns(num_threads, INVALID_LSN);
+  int offset = 0;
+  for (size_t i = 0; i < headers.size(); i++) {
+    ASSERT_EQ(static_cast<lsn_t>(i), headers[i].lsn);
+    ASSERT_EQ(LogRecordType::INSERT, headers[i].type);
+    txn_id_t t = headers[i].txn_id;
+    ASSERT_LE(0, t);
+    ASSERT_GT(num_threads, t);
+    EXPECT_EQ(prev_lsns[t], headers[i].prev_lsn);
+    prev_lsns[t] = headers[i].lsn;
+    // each thread's records appear in the order it appended them, with their payload intact
+    RID rid;
+    disk_manager.ReadLog(reinterpret_cast<char *>(&rid), sizeof(rid), offset + sizeof(LogHeader));
+    EXPECT_EQ(RID(t, next_slot[t]++), rid);
+    char tuple_data[128];
+    disk_manager.ReadLog(tuple_data, headers[i].size - sizeof(LogHeader) - sizeof(RID),
+                         offset + sizeof(LogHeader) + sizeof(RID));
+    Tuple tuple;
+    tuple.DeserializeFrom(tuple_data);
+    EXPECT_EQ(maker.Make(t).GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(maker.Make(t).GetData(), tuple.GetData(), tuple.GetLength()));
+    offset += headers[i].size;
+  }
+  disk_manager.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, AppendBenchmark) {
+  // Append 400000 INSERT records from 1 to 16 threads with the flush thread running, as an insert-heavy workload
+  // does. Numbers are printed, not asserted.
+  const int num_records = 400000;
+  TupleMaker maker;
+  Tuple tuple = maker.Make(0);
+  printf("%10s %14s %14s\n", "threads", "appends/s", "MB/s");
+  for (int num_threads : {1, 4, 16}) {
+    remove("test.log");
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    log_manager.RunFlushThread();
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < num_records / num_threads; i++) {
+          LogRecord insert(t, INVALID_LSN, LogRecordType::INSERT, RID(t, i), tuple);
+          log_manager.AppendLogRecord(&insert);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    log_manager.StopFlushThread();
+    LogRecord insert(0, INVALID_LSN, LogRecordType::INSERT, RID(), tuple);
+    printf("%10d %14.0f %14.1f\n", num_threads, num_records / elapsed.count(),
+           static_cast<double>(num_records) * insert.GetSize() / elapsed.count() / 1e6);
+    disk_manager.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(LogManagerTest, GroupCommitBenchmark) {
+  // Commit 2000 transactions from 1 to 16 threads, every commit waiting for its record to be synced. Numbers are
+  // printed, not asserted.
+  const int num_commits = 2000;
+  printf("%10s %14s %18s\n", "threads", "commits/s", "commits/fsync");
+  for (int num_threads : {1, 4, 16}) {
+    remove("test.log");
+    DiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    log_manager.RunFlushThread();
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < num_commits / num_threads; i++) {
+          LogRecord commit(t, INVALID_LSN, LogRecordType::COMMIT);
+          log_manager.Flush(log_manager.AppendLogRecord(&commit));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    log_manager.StopFlushThread();
+    printf("%10d %14.0f %18.1f\n", num_threads, num_commits / elapsed.count(),
+           static_cast<double>(num_commits) / disk_manager.GetNumFlushes());
+    disk_manager.ShutDown();
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,156 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <unistd.h>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <future>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+
+namespace bustub {
+
+class AsyncDiskManagerTest : public ::testing::TestWithParam<bool> {
+ protected:
+  // This function is called before every test.
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+  }
+
+  // This function is called after every test.
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+  };
+};
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, ReadWritePageTest) {
+  const size_t queue_depth = 8;
+  const int num_pages = 100;
+  AsyncDiskManager dm("test.db", queue_depth, GetParam());
+  if (!GetParam()) {
+    EXPECT_EQ(AsyncIOBackend::THREAD_POOL, dm.GetBackend());
+  }
+  EXPECT_EQ(queue_depth, dm.GetQueueDepth());
+
+  // Scenario: more writes than the queue is deep, all in flight before the first wait.
+  std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<std::future<bool>> done;
+  for (int i = 0; i < num_pages; i++) {
+    snprintf(pages[i].data(), PAGE_SIZE, "page %d", i);
+    done.push_back(dm.WritePageAsync(i, pages[i].data()));
+  }
+  for (auto &write : done) {
+    EXPECT_TRUE(write.get());
+  }
+
+  // Scenario: asynchronous reads see the pages, and so do the synchronous ones of DiskManager.
+  std::vector<std::vector<char>> read(num_pages, std::vector<char>(PAGE_SIZE, 'x'));
+  done.clear();
+  for (int i = num_pages - 1; i >= 0; i--) {
+    done.push_back(dm.ReadPageAsync(i, read[i].data()));
+  }
+  for (auto &read_done : done) {
+    EXPECT_TRUE(read_done.get());
+  }
+  EXPECT_EQ(pages, read);
+  char buf[PAGE_SIZE];
+  dm.ReadPage(42, buf);
+  EXPECT_EQ(0, std::memcmp(buf, pages[42].data(), PAGE_SIZE));
+
+  // Scenario: a page past the end of the file reads as zeros.
+  std::vector<char> past_end(PAGE_SIZE, 'x');
+  EXPECT_TRUE(dm.ReadPageAsync(num_pages + 10, past_end.data()).get());
+  EXPECT_EQ(std::vector<char>(PAGE_SIZE, 0), past_end);
+
+  // Scenario: Drain waits for requests nobody waits on.
+  for (int i = 0; i < num_pages; i++) {
+    dm.WritePageAsync(i, pages[0].data());
+  }
+  dm.Drain();
+  dm.ReadPage(num_pages - 1, buf);
+  EXPECT_EQ(0, std::memcmp(buf, pages[0].data(), PAGE_SIZE));
+
+  // Scenario: the file ends inside the last page; the read continues after the short transfer and finds the end of
+  // the file, only the rest of the page reads as zeros.
+  const int tail = 100;
+  ASSERT_EQ(0, truncate("test.db", static_cast<off_t>(num_pages - 1) * PAGE_SIZE + tail));
+  std::vector<char> partial(PAGE_SIZE, 'x');
+  std::vector<char> expected(PAGE_SIZE, 0);
+  memcpy(expected.data(), pages[0].data(), tail);
+  EXPECT_TRUE(dm.ReadPageAsync(num_pages - 1, partial.data()).get());
+  EXPECT_EQ(expected, partial);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, QueueDepthBenchmark) {
+  // Write and read back 4096 random pages, with one I/O in flight through DiskManager and with a deep queue through
+  // the asynchronous backend. Numbers are printed, not asserted.
+  const int num_pages = 4096;
+  std::vector<char> data(PAGE_SIZE, 'a');
+  std::vector<std::vector<char>> buffers(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<page_id_t> order(num_pages);
+  for (int i = 0; i < num_pages; i++) {
+    order[i] = (i * 2654435761U) % num_pages;
+  }
+
+  printf("%14s %12s %12s\n", "backend", "write MB/s", "read MB/s");
+  {
+    DiskManager dm("test.db");
+    auto start = std::chrono::steady_clock::now();
+    for (auto page_id : order) {
+      dm.WritePage(page_id, data.data());
+    }
+    std::chrono::duration<double> write = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (auto page_id : order) {
+      dm.ReadPage(page_id, buffers[page_id].data());
+    }
+    std::chrono::duration<double> read = std::chrono::steady_clock::now() - start;
+    printf("%14s %12.1f %12.1f\n", "sync", num_pages * PAGE_SIZE / write.count() / 1e6,
+           num_pages * PAGE_SIZE / read.count() / 1e6);
+    dm.ShutDown();
+  }
+  for (size_t queue_depth : {1, 8, 64}) {
+    AsyncDiskManager dm("test.db", queue_depth, GetParam());
+    auto start = std::chrono::steady_clock::now();
+    for (auto page_id : order) {
+      dm.WritePageAsync(page_id, data.data());
+    }
+    dm.Drain();
+    std::chrono::duration<double> write = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (auto page_id : order) {
+      dm.ReadPageAsync(page_id, buffers[page_id].data());
+    }
+    dm.Drain();
+    std::chrono::duration<double> read = std::chrono::steady_clock::now() - start;
+    char name[32];
+    snprintf(name, sizeof(name), "%s qd=%zu", dm.GetBackend() == AsyncIOBackend::IO_URING ? "uring" : "pool",
+             queue_depth);
+    printf("%14s %12.1f %12.1f\n", name, num_pages * PAGE_SIZE / write.count() / 1e6,
+           num_pages * PAGE_SIZE / read.count() / 1e6);
+    EXPECT_EQ(data, buffers[order[0]]);
+    dm.ShutDown();
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncDiskManagerTest, ::testing::Values(true, false));
+
+}  // namespace bustub
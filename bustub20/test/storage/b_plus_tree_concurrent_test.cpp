@@ -2,6 +2,7 @@
  * b_plus_tree_test.cpp
  */
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -332,4 +333,155 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, ReadWhileInsertTest) {
+  // Readers descend the inner nodes optimistically while writers keep adding split leaves to them; every key that
+  // was in the tree before the writers started must always be found.
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(400, disk_manager);
+  // small leaves, so that the inserts keep changing the root inner node (the tree stays two levels deep)
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 32, 128);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_initial = 200;
+  const int64_t num_inserted = 600;
+  GenericKey<8> index_key;
+  RID rid;
+  for (int64_t key = 1; key <= num_initial; key++) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid);
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<int> missing{0};
+  std::vector<std::thread> threads;
+  for (int r = 0; r < 2; r++) {
+    threads.emplace_back([&] {
+      GenericKey<8> key_to_find;
+      std::vector<RID> rids;
+      do {
+        for (int64_t key = 1; key <= num_initial; key++) {
+          rids.clear();
+          key_to_find.SetFromInteger(key);
+          if (!tree.GetValue(key_to_find, &rids) || rids[0].GetSlotNum() != key) {
+            missing++;
+          }
+        }
+      } while (!done);
+    });
+  }
+  for (int w = 0; w < 2; w++) {
+    threads.emplace_back([&, w] {
+      GenericKey<8> key_to_insert;
+      RID value;
+      for (int64_t key = num_initial + 1 + w; key <= num_initial + num_inserted; key += 2) {
+        value.Set(0, key);
+        key_to_insert.SetFromInteger(key);
+        tree.Insert(key_to_insert, value);
+      }
+    });
+  }
+  threads[2].join();
+  threads[3].join();
+  done = true;
+  threads[0].join();
+  threads[1].join();
+  EXPECT_EQ(0, missing.load());
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= num_initial + num_inserted; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, ReadWhileDeleteTest) {
+  // Readers descend the inner nodes optimistically while writers delete keys, so that leaves and inner nodes keep
+  // merging with and borrowing from their siblings; every key that is never deleted must always be found.
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+  // small nodes, so that the tree is four or more levels deep and the merges reach the inner levels
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 8, 8);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 2000;
+  // every fourth key stays, the others are deleted
+  const int64_t kept_every = 4;
+  GenericKey<8> index_key;
+  RID rid;
+  for (int64_t key = 1; key <= num_keys; key++) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid);
+  }
+
+  std::atomic<bool> done{false};
+  std::atomic<int> missing{0};
+  std::vector<std::thread> threads;
+  for (int r = 0; r < 2; r++) {
+    threads.emplace_back([&] {
+      GenericKey<8> key_to_find;
+      std::vector<RID> rids;
+      do {
+        for (int64_t key = kept_every; key <= num_keys; key += kept_every) {
+          rids.clear();
+          key_to_find.SetFromInteger(key);
+          if (!tree.GetValue(key_to_find, &rids) || rids[0].GetSlotNum() != key) {
+            missing++;
+          }
+        }
+      } while (!done);
+    });
+  }
+  for (int w = 0; w < 2; w++) {
+    threads.emplace_back([&, w] {
+      GenericKey<8> key_to_remove;
+      for (int64_t key = 1 + w; key <= num_keys; key += 2) {
+        if (key % kept_every != 0) {
+          key_to_remove.SetFromInteger(key);
+          tree.Remove(key_to_remove);
+        }
+      }
+    });
+  }
+  threads[2].join();
+  threads[3].join();
+  done = true;
+  threads[0].join();
+  threads[1].join();
+  EXPECT_EQ(0, missing.load());
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % kept_every == 0, tree.GetValue(index_key, &rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_compression_benchmark_test.cpp
+//
+// Identification: test/storage/disk_compression_benchmark_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "catalog/table_generator.h"
+#include "concurrency/transaction_manager.h"
+#include "execution/executor_context.h"
+#include "gtest/gtest.h"
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+namespace {
+
+void RemoveFiles() {
+  remove("compression_test.db");
+  remove("compression_test.log");
+  remove("compression_test.fsm");
+  remove("compression_test.map");
+}
+
+/** Build the executor test tables on a fresh database, the same way ExecutorTest does, and flush them. */
+void GenerateTables(DiskManager *disk_manager) {
+  BufferPoolManager bpm(32, disk_manager);
+  page_id_t page_id;
+  bpm.NewPage(&page_id);
+  LockManager lock_manager;
+  TransactionManager txn_mgr(&lock_manager, nullptr);
+  Catalog catalog(&bpm, &lock_manager, nullptr);
+  Transaction *txn = txn_mgr.Begin();
+  ExecutorContext exec_ctx(txn, &catalog, &bpm, &txn_mgr, &lock_manager);
+  TableGenerator gen{&exec_ctx};
+  gen.GenerateTestTables();
+  txn_mgr.Commit(txn);
+  delete txn;
+  bpm.FlushAllPages();
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(DiskCompressionBenchmark, TableGeneratorTest) {
+  // Store the TableGenerator tables uncompressed and compressed, then read and rewrite all their pages. The page cache
+  // is warm, so the timings are the CPU price of compression; the disk bandwidth it saves is the size ratio. Numbers
+  // are printed, not asserted.
+  const int rounds = 200;
+  printf("%12s %8s %12s %8s %12s %12s\n", "mode", "pages", "bytes", "ratio", "read MB/s", "write MB/s");
+  int64_t stream_bytes = 0;
+  for (auto io_mode : {DiskIOMode::STREAM, DiskIOMode::COMPRESSED}) {
+    RemoveFiles();
+    DiskManager disk_manager("compression_test.db", io_mode);
+    GenerateTables(&disk_manager);
+    // no page was deallocated, so the next page id is the number of pages
+    page_id_t num_pages = disk_manager.AllocatePage();
+    std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      disk_manager.ReadPage(page_id, pages[page_id].data());
+    }
+
+    // rewrites land in the slots the pages already have
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+        disk_manager.WritePage(page_id, pages[page_id].data());
+      }
+    }
+    std::chrono::duration<double> write = std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+        disk_manager.ReadPage(page_id, pages[page_id].data());
+      }
+    }
+    std::chrono::duration<double> read = std::chrono::steady_clock::now() - start;
+
+    int64_t bytes = io_mode == DiskIOMode::COMPRESSED ? disk_manager.GetCompressedFileSize()
+                                                      : static_cast<int64_t>(num_pages) * PAGE_SIZE;
+    if (io_mode == DiskIOMode::STREAM) {
+      stream_bytes = bytes;
+    }
+    double megabytes = static_cast<double>(rounds) * num_pages * PAGE_SIZE / 1e6;
+    printf("%12s %8d %12ld %8.2f %12.0f %12.0f\n", io_mode == DiskIOMode::STREAM ? "stream" : "compressed", num_pages,
+           static_cast<long>(bytes), static_cast<double>(stream_bytes) / bytes,  // NOLINT
+           megabytes / read.count(), megabytes / write.count());
+    disk_manager.ShutDown();
+  }
+  RemoveFiles();
+}
+
+}  // namespace bustub
@@ -10,7 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -24,12 +29,18 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
+    remove("test.crc");
+    remove("test.map");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
+    remove("test.crc");
+    remove("test.map");
   };
 };
 
@@ -55,6 +66,380 @@ TEST_F(DiskManagerTest, ReadWritePageTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReadPagesTest) {
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+
+  // Two runs ({1, 2, 3} and {5, 6}) given out of order, plus a page past the end of the file.
+  std::vector<page_id_t> page_ids{6, 2, 1, 5, 3, 12};
+  std::vector<std::vector<char>> buffers(page_ids.size(), std::vector<char>(PAGE_SIZE, 'x'));
+  std::vector<char *> page_data;
+  for (auto &buffer : buffers) {
+    page_data.push_back(buffer.data());
+  }
+  dm.ReadPages(page_ids, page_data);
+
+  for (size_t i = 0; i + 1 < page_ids.size(); i++) {
+    snprintf(data, sizeof(data), "page %d", page_ids[i]);
+    EXPECT_EQ(std::memcmp(page_data[i], data, PAGE_SIZE), 0);
+  }
+  EXPECT_EQ(std::vector<char>(PAGE_SIZE, 0), buffers.back());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageReuseTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  char data[PAGE_SIZE] = {0};
+  for (page_id_t page_id = 0; page_id < 10; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+  }
+
+  // Scenario: deallocated ids come back lowest first, a double deallocation is ignored.
+  dm.DeallocatePage(7);
+  dm.DeallocatePage(3);
+  dm.DeallocatePage(5);
+  dm.DeallocatePage(3);
+  // Scenario: an id past the allocated ones is ignored, it would be handed out twice.
+  dm.DeallocatePage(12);
+  EXPECT_EQ(3, dm.GetNumFreePages());
+  EXPECT_EQ(3, dm.AllocatePage());
+
+  // Scenario: buffer pools that stride their page ids only get ids of their own residue class.
+  EXPECT_EQ(INVALID_PAGE_ID, dm.ReuseFreePage(4, 0));
+  EXPECT_EQ(7, dm.ReuseFreePage(4, 3));
+  EXPECT_EQ(5, dm.ReuseFreePage(2, 1));
+  EXPECT_EQ(0, dm.GetNumFreePages());
+  EXPECT_EQ(10, dm.AllocatePage());
+
+  // Scenario: ids a buffer pool handed out itself can be deallocated, and are not allocated again.
+  dm.MarkPageAllocated(12);
+  dm.DeallocatePage(12);
+  EXPECT_EQ(12, dm.ReuseFreePage(1, 0));
+  EXPECT_EQ(13, dm.AllocatePage());
+
+  // Scenario: the free page map survives a restart, and new pages start past the end of the file.
+  dm.WritePage(10, data);
+  dm.DeallocatePage(2);
+  dm.DeallocatePage(9);
+  dm.AllocatePage();
+  dm.ShutDown();
+  auto reopened = DiskManager(db_file);
+  EXPECT_EQ(1, reopened.GetNumFreePages());
+  EXPECT_EQ(9, reopened.AllocatePage());
+  EXPECT_EQ(11, reopened.AllocatePage());
+  reopened.ShutDown();
+
+  // Scenario: a free page map left behind by a removed database file is discarded.
+  remove("test.db");
+  auto fresh = DiskManager(db_file);
+  for (int i = 0; i < 5; i++) {
+    fresh.AllocatePage();
+  }
+  fresh.DeallocatePage(4);
+  fresh.ShutDown();
+  remove("test.db");
+  auto recreated = DiskManager(db_file);
+  EXPECT_EQ(0, recreated.GetNumFreePages());
+  EXPECT_EQ(0, recreated.AllocatePage());
+  recreated.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PositionalIOTest) {
+  for (auto io_mode : {DiskIOMode::POSITIONAL, DiskIOMode::DIRECT}) {
+    remove("test.db");
+    auto dm = DiskManager("test.db", io_mode);
+    EXPECT_NE(DiskIOMode::STREAM, dm.GetIOMode());
+
+    // Scenario: pages written by several threads at once all land, from aligned and unaligned buffers.
+    const int num_threads = 4;
+    const int pages_per_thread = 16;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&dm, t] {
+        auto *aligned = static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE));
+        char unaligned[PAGE_SIZE + 1];
+        for (page_id_t page_id = t; page_id < num_threads * pages_per_thread; page_id += num_threads) {
+          char *data = page_id % 2 == 0 ? aligned : unaligned + 1;
+          memset(data, 0, PAGE_SIZE);
+          snprintf(data, PAGE_SIZE, "page %d", page_id);
+          dm.WritePage(page_id, data);
+        }
+        free(aligned);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // Scenario: ReadPage and ReadPages see them; pages past the end read as zeros without touching the file.
+    char data[PAGE_SIZE];
+    char buf[PAGE_SIZE + 1];
+    for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; page_id++) {
+      memset(data, 0, PAGE_SIZE);
+      snprintf(data, PAGE_SIZE, "page %d", page_id);
+      dm.ReadPage(page_id, buf + 1);
+      EXPECT_EQ(0, std::memcmp(buf + 1, data, PAGE_SIZE));
+    }
+    std::vector<page_id_t> page_ids{6, 2, 1, 5, 3, 64, 63};
+    std::vector<std::vector<char>> buffers(page_ids.size(), std::vector<char>(PAGE_SIZE, 'x'));
+    std::vector<char *> page_data;
+    for (auto &buffer : buffers) {
+      page_data.push_back(buffer.data());
+    }
+    dm.ReadPages(page_ids, page_data);
+    for (size_t i = 0; i < page_ids.size(); i++) {
+      memset(data, 0, PAGE_SIZE);
+      if (page_ids[i] < num_threads * pages_per_thread) {
+        snprintf(data, PAGE_SIZE, "page %d", page_ids[i]);
+      }
+      EXPECT_EQ(0, std::memcmp(page_data[i], data, PAGE_SIZE));
+    }
+    EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+    dm.ShutDown();
+
+    // Scenario: the stream mode reads what the positional mode wrote.
+    auto stream = DiskManager("test.db");
+    stream.ReadPage(7, buf);
+    EXPECT_EQ(0, strcmp(buf, "page 7"));
+    stream.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PageChecksumTest) {
+  for (auto io_mode : {DiskIOMode::STREAM, DiskIOMode::POSITIONAL}) {
+    remove("test.db");
+    char data[PAGE_SIZE] = {0};
+    char buf[PAGE_SIZE] = {0};
+    auto dm = DiskManager("test.db", io_mode, true);
+    EXPECT_TRUE(dm.HasPageChecksums());
+    for (page_id_t page_id = 0; page_id < 4; page_id++) {
+      memset(data, 'a' + page_id, sizeof(data));
+      snprintf(data, sizeof(data), "page %d", page_id);
+      dm.WritePage(page_id, data);
+    }
+
+    // Scenario: intact pages, and pages that were never written, verify.
+    dm.ReadPage(2, buf);
+    EXPECT_EQ(0, strcmp(buf, "page 2"));
+    EXPECT_TRUE(dm.VerifyPage(9, buf));
+    EXPECT_EQ(0, dm.GetNumChecksumFailures());
+    dm.ShutDown();
+
+    // Scenario: a flipped bit and a page cut short by a torn write are caught on read, also after a restart.
+    {
+      std::fstream file("test.db", std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(PAGE_SIZE + 100);
+      file.put('!');
+    }
+    truncate("test.db", 3 * PAGE_SIZE + 512);
+    auto reopened = DiskManager("test.db", io_mode, true);
+    reopened.ReadPage(1, buf);
+    EXPECT_EQ(1, reopened.GetNumChecksumFailures());
+    std::vector<page_id_t> page_ids{0, 2, 3};
+    std::vector<std::vector<char>> buffers(page_ids.size(), std::vector<char>(PAGE_SIZE));
+    std::vector<char *> page_data{buffers[0].data(), buffers[1].data(), buffers[2].data()};
+    reopened.ReadPages(page_ids, page_data);
+    EXPECT_EQ(2, reopened.GetNumChecksumFailures());
+    EXPECT_FALSE(reopened.VerifyPage(3, page_data[2]));
+
+    // Scenario: rewriting the page stamps the new checksum.
+    reopened.WritePage(1, data);
+    reopened.ReadPage(1, buf);
+    EXPECT_TRUE(reopened.VerifyPage(1, buf));
+    EXPECT_EQ(3, reopened.GetNumChecksumFailures());
+    reopened.ShutDown();
+  }
+
+  // Scenario: a database opened without checksums drops the stale checksum file.
+  auto unchecked = DiskManager("test.db");
+  unchecked.ShutDown();
+  EXPECT_FALSE(std::ifstream("test.crc").good());
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompressedPageTest) {
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+  auto dm = DiskManager("test.db", DiskIOMode::COMPRESSED, true);
+  EXPECT_EQ(DiskIOMode::COMPRESSED, dm.GetIOMode());
+
+  // Scenario: mostly empty pages take a sector each, a page of noise is stored as is.
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    memset(data, 0, sizeof(data));
+    snprintf(data, sizeof(data), "page %d", page_id);
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_EQ(8 * 512, dm.GetCompressedFileSize());
+  std::vector<char> noise(PAGE_SIZE);
+  for (size_t i = 0; i < noise.size(); i++) {
+    noise[i] = static_cast<char>(rand());  // NOLINT
+  }
+  dm.WritePage(8, noise.data());
+  EXPECT_EQ(8 * 512 + PAGE_SIZE, dm.GetCompressedFileSize());
+  dm.ReadPage(8, buf);
+  EXPECT_EQ(0, memcmp(buf, noise.data(), PAGE_SIZE));
+  dm.ReadPage(3, buf);
+  EXPECT_EQ(0, strcmp(buf, "page 3"));
+  dm.ReadPage(42, buf);  // tolerate empty read
+  EXPECT_EQ(0, buf[0]);
+
+  // Scenario: a page that grows moves to a larger slot; the page that shrinks next takes the freed sector.
+  std::vector<char> half_noise(PAGE_SIZE, 0);
+  memcpy(half_noise.data(), noise.data(), PAGE_SIZE / 2);
+  dm.WritePage(2, half_noise.data());
+  int64_t grown = dm.GetCompressedFileSize();
+  EXPECT_LT(8 * 512 + PAGE_SIZE, grown);
+  memset(data, 0, sizeof(data));
+  strcpy(data, "page 8 again");  // NOLINT
+  dm.WritePage(8, data);
+  EXPECT_EQ(grown, dm.GetCompressedFileSize());
+  dm.WritePage(9, data);
+  EXPECT_EQ(grown, dm.GetCompressedFileSize());
+
+  // Scenario: the slots of a deallocated page go to new pages.
+  dm.DeallocatePage(2);
+  std::vector<page_id_t> page_ids{9, 1, 8};
+  std::vector<std::vector<char>> buffers(page_ids.size(), std::vector<char>(PAGE_SIZE));
+  std::vector<char *> page_data{buffers[0].data(), buffers[1].data(), buffers[2].data()};
+  dm.ReadPages(page_ids, page_data);
+  EXPECT_EQ(0, strcmp(page_data[0], "page 8 again"));
+  EXPECT_EQ(0, strcmp(page_data[1], "page 1"));
+  EXPECT_EQ(0, strcmp(page_data[2], "page 8 again"));
+  dm.WritePage(10, half_noise.data());
+  EXPECT_EQ(grown, dm.GetCompressedFileSize());
+  dm.ShutDown();
+
+  // Scenario: after a restart the page map finds every page and the free slots are rebuilt from its gaps.
+  auto reopened = DiskManager("test.db", DiskIOMode::COMPRESSED, true);
+  EXPECT_EQ(grown, reopened.GetCompressedFileSize());
+  reopened.ReadPage(10, buf);
+  EXPECT_EQ(0, memcmp(buf, half_noise.data(), PAGE_SIZE));
+  reopened.ReadPage(7, buf);
+  EXPECT_EQ(0, strcmp(buf, "page 7"));
+  reopened.WritePage(11, data);
+  EXPECT_EQ(grown, reopened.GetCompressedFileSize());
+  EXPECT_EQ(0, reopened.GetNumChecksumFailures());
+
+  // Scenario: a corrupted slot does not decompress, the page reads as zeros and fails its checksum.
+  {
+    std::fstream file("test.db", std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(5 * 512);
+    file.put(static_cast<char>(0xff));
+  }
+  reopened.ReadPage(5, buf);
+  EXPECT_EQ(1, reopened.GetNumChecksumFailures());
+  reopened.ShutDown();
+
+  // Scenario: a new database drops the stale page map.
+  remove("test.db");
+  auto fresh = DiskManager("test.db", DiskIOMode::COMPRESSED);
+  EXPECT_EQ(0, fresh.GetCompressedFileSize());
+  fresh.ReadPage(1, buf);
+  EXPECT_EQ(0, buf[0]);
+  fresh.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, MmapReadOnlyTest) {
+  char data[PAGE_SIZE] = {0};
+  char buf[PAGE_SIZE] = {0};
+
+  // Scenario: a read-only database has to exist.
+  EXPECT_THROW(DiskManager("test.db", DiskIOMode::MMAP_READ_ONLY), Exception);
+
+  auto writer = DiskManager("test.db", DiskIOMode::STREAM, true);
+  for (page_id_t page_id = 0; page_id < 3; page_id++) {
+    snprintf(data, sizeof(data), "page %d", page_id);
+    writer.WritePage(page_id, data);
+  }
+  writer.DeallocatePage(1);
+  writer.ShutDown();
+  truncate("test.db", 2 * PAGE_SIZE + 100);
+
+  // Scenario: pages are read from the mapping, the tail of a partial last page reads as zeros.
+  auto dm = DiskManager("test.db", DiskIOMode::MMAP_READ_ONLY);
+  EXPECT_EQ(DiskIOMode::MMAP_READ_ONLY, dm.GetIOMode());
+  EXPECT_EQ(3, dm.GetNumMappedPages());
+  EXPECT_EQ(0, strcmp(dm.GetMappedPage(1), "page 1"));
+  EXPECT_EQ(0, dm.GetMappedPage(2)[PAGE_SIZE - 1]);
+  EXPECT_EQ(nullptr, dm.GetMappedPage(3));
+  EXPECT_EQ(nullptr, dm.GetMappedPage(-1));
+  std::vector<page_id_t> page_ids{2, 0, 7};
+  std::vector<std::vector<char>> buffers(page_ids.size(), std::vector<char>(PAGE_SIZE, 'x'));
+  std::vector<char *> page_data{buffers[0].data(), buffers[1].data(), buffers[2].data()};
+  dm.ReadPages(page_ids, page_data);
+  EXPECT_EQ(0, strcmp(page_data[0], "page 2"));
+  EXPECT_EQ(0, strcmp(page_data[1], "page 0"));
+  EXPECT_EQ(0, page_data[2][0]);
+
+  // Scenario: hints are passed on for ranges inside the mapping.
+  EXPECT_TRUE(dm.AdviseMapped(AccessPattern::SEQUENTIAL));
+  EXPECT_TRUE(dm.AdviseMapped(AccessPattern::RANDOM, 1, 100));
+  EXPECT_TRUE(dm.AdviseMapped(AccessPattern::WILLNEED, 2, 1));
+  EXPECT_FALSE(dm.AdviseMapped(AccessPattern::NORMAL, 3));
+
+  // Scenario: writes and deallocations are refused, the files next to the db file stay as they are.
+  memset(data, 'w', sizeof(data));
+  dm.WritePage(0, data);
+  dm.DeallocatePage(2);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(0, strcmp(buf, "page 0"));
+  dm.ShutDown();
+  EXPECT_TRUE(std::ifstream("test.crc").good());
+  auto reopened = DiskManager("test.db");
+  EXPECT_EQ(1, reopened.GetNumFreePages());
+  EXPECT_EQ(0, reopened.GetNumMappedPages());
+  reopened.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentReadBenchmark) {
+  // Read 4096 pages from 1, 4 and 16 threads in every mode. Numbers are printed, not asserted.
+  const int num_pages = 4096;
+  char data[PAGE_SIZE] = {0};
+  printf("%12s %10s %10s %10s\n", "mode", "1 thr MB/s", "4 thr MB/s", "16 thr MB/s");
+  for (auto io_mode : {DiskIOMode::STREAM, DiskIOMode::POSITIONAL, DiskIOMode::DIRECT}) {
+    auto dm = DiskManager("test.db", io_mode);
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      dm.WritePage(page_id, data);
+    }
+    const char *names[] = {"stream", "positional", "direct"};
+    printf("%12s", names[static_cast<int>(dm.GetIOMode())]);
+    for (int num_threads : {1, 4, 16}) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&dm, t, num_threads] {
+          auto *buf = static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE));
+          for (page_id_t page_id = t; page_id < num_pages; page_id += num_threads) {
+            dm.ReadPage(page_id, buf);
+          }
+          free(buf);
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      printf(" %10.1f", num_pages * PAGE_SIZE / elapsed.count() / 1e6);
+    }
+    printf("\n");
+    dm.ShutDown();
+    remove("test.db");
+  }
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
@@ -47,13 +47,12 @@ namespace bustub {
 
     auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool { 
         //移出最旧的
+        //命中路径不拿bpm的latch_也会Pin/Unpin，判空要在锁里
+        std::lock_guard<std::mutex> guard(mu);
         if(list.size()>0){
-        mu.lock();
             auto back=list.back();
             list.pop_back();
             map.erase(back);
-        mu.unlock();
-        
             *frame_id=back;
         return true;
         }
@@ -82,6 +81,12 @@ namespace bustub {
         mu.unlock();
     }
 
+    void LRUReplacer::EvictionOrder(std::vector<frame_id_t> *frame_ids) {
+        std::lock_guard<std::mutex> guard(mu);
+        //新的从前面插入，旧的从后面淘汰
+        frame_ids->assign(list.rbegin(), list.rend());
+    }
+
     auto LRUReplacer::Size() -> size_t {
         size_t s;
         // mu.lock();
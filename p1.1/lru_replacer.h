@@ -63,6 +63,8 @@ class LRUReplacer : public Replacer {
 
   auto Size() -> size_t override;
 
+  void EvictionOrder(std::vector<frame_id_t> *frame_ids) override;
+
  private:
   size_t max_cnt;
  std::mutex mu;
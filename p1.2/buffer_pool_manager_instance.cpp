@@ -12,6 +12,13 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+#include "common/logger.h"
 #include "common/macros.h"
 
 namespace bustub {
@@ -20,101 +27,564 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManag
     : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type, size_t lru_k,
+                                                     const FrameArenaOptions &arena_options, size_t max_pool_size)
     : pool_size_(pool_size),
+      max_pool_size_(std::max(pool_size, max_pool_size)),
       num_instances_(num_instances),
       instance_index_(instance_index),
       next_page_id_(instance_index),
+      frame_arena_(max_pool_size_, arena_options),
+      frame_descriptors_(max_pool_size_),
       disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager),
+      page_table_(max_pool_size_) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
   // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+  //按最大容量分配，Resize只改用到第几个frame
+  pages_ = new Page[max_pool_size_];
+  frame_arena_.BindPages(pages_);
+  frame_descriptors_.BindPages(pages_);
+  switch (replacer_type) {
+    case ReplacerType::INTRUSIVE_LRU:
+      replacer_ = new IntrusiveLRUReplacer(max_pool_size_);
+      break;
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(max_pool_size_, lru_k);
+      break;
+    case ReplacerType::LRU:
+    default:
+      replacer_ = new LRUReplacer(max_pool_size_);
+      break;
+  }
 
   // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+  //free list里的frame都是占住的，命中路径pin不上；pool_size以上的frame也占着，扩容时再放进free list
+  for (size_t i = 0; i < max_pool_size_; ++i) {
+    frame_descriptors_.TryClaim(static_cast<frame_id_t>(i));
+    if (i < pool_size) {
+      free_list_.emplace_back(static_cast<int>(i));
+    }
   }
+  flusher_thread_ = std::thread(&BufferPoolManagerInstance::RunBackgroundFlusher, this);
+  prefetch_thread_ = std::thread(&BufferPoolManagerInstance::RunPrefetcher, this);
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
+  //先把工作集记下来，再停后台线程
+  if (!warmup_path_.empty()) {
+    SaveWarmupSnapshot(warmup_path_);
+  }
+  warmup_stop_ = true;
+  if (warmup_thread_.joinable()) {
+    warmup_thread_.join();
+  }
+  {
+    std::lock_guard<std::mutex> guard(flusher_latch_);
+    flusher_stop_ = true;
+  }
+  flusher_cv_.notify_one();
+  flusher_thread_.join();
+  {
+    std::lock_guard<std::mutex> guard(prefetch_latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_one();
+  prefetch_thread_.join();
   delete[] pages_;
   delete replacer_;
 }
+void BufferPoolManagerInstance::SetStatsDumpInterval(std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(flusher_latch_);
+  stats_dump_interval_ = interval;
+  next_stats_dump_ = std::chrono::steady_clock::now() + interval;
+}
+
 auto BufferPoolManagerInstance::GetPageByPageId(page_id_t pageid) 
     -> GetPageByPageIdRet{
-  auto find = page_table_.find(pageid);
-  if (find != page_table_.end()) {
-    return {find->second,&pages_[find->second]};
+  frame_id_t fid;
+  if (page_table_.Find(pageid, &fid)) {
+    return {fid,&pages_[fid]};
   }
   return {-1,nullptr};
 }
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
+  //持有latch_时frame不会被换绑，可以放心写盘
+  std::lock_guard<std::mutex> guard(latch_);
   auto res = GetPageByPageId(page_id);
   auto p=res.page;
   if (p) {
-    disk_manager_->WritePage(page_id, p->GetData());
-  } else {
-    // printf("page not found!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
-    // exit(0);
-    return false;
+    // Make sure you call DiskManager::WritePage!
+    FlushFrame(res.fid);
+    return true;
   }
-  // Make sure you call DiskManager::WritePage!
   return false;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
-  for (auto pair : page_table_) {
-    if (pages_[pair.second].IsDirty()) {
-      FlushPgImp(pair.first);
+  std::lock_guard<std::mutex> guard(latch_);
+  //只看脏页位图，干净的frame一次跳过64个
+  for (auto fid = frame_descriptors_.FindDirty(0); fid >= 0; fid = frame_descriptors_.FindDirty(fid + 1)) {
+    if (frame_descriptors_.GetPageId(fid) != INVALID_PAGE_ID) {
+      FlushFrame(fid);
+    }
+  }
+}
+
+void BufferPoolManagerInstance::FlushFrame(frame_id_t fid) {
+  auto p = &pages_[fid];
+  //显式flush不能像换出那样跳过，先把日志刷到page的LSN再写
+  if (!CanWriteBack(p)) {
+    log_manager_->Flush(p->GetLSN());
+  }
+  //占住frame再写，写完清脏位不会盖掉写的同时做的修改；
+  //被pin着的照写，脏位留着，之后换出或flush时再写一次
+  bool claimed = frame_descriptors_.TryClaim(fid);
+  WriteBack(frame_descriptors_.GetPageId(fid), p);
+  if (claimed) {
+    frame_descriptors_.SetDirty(fid, false);
+    frame_descriptors_.SetPinCount(fid, 0);
+  }
+}
+
+auto BufferPoolManagerInstance::CanWriteBack(Page *page) -> bool {
+  return log_manager_ == nullptr || !enable_logging || page->GetLSN() <= log_manager_->GetPersistentLSN();
+}
+
+void BufferPoolManagerInstance::WriteBack(page_id_t page_id, Page *page) {
+  auto start = std::chrono::steady_clock::now();
+  disk_manager_->WritePage(page_id, page->GetData());
+  counters_.RecordWriteBack(std::chrono::steady_clock::now() - start);
+}
+
+void BufferPoolManagerInstance::RunBackgroundFlusher() {
+  std::unique_lock<std::mutex> lock(flusher_latch_);
+  while (!flusher_cv_.wait_for(lock, FLUSHER_INTERVAL, [this] { return flusher_stop_; })) {
+    lock.unlock();
+    FlushDirtyFrames(FLUSHER_BATCH_SIZE);
+    lock.lock();
+    //统计输出的精度就是flusher的唤醒间隔，够用了
+    auto now = std::chrono::steady_clock::now();
+    if (stats_dump_interval_.count() > 0 && now >= next_stats_dump_) {
+      LOG_INFO("buffer pool instance %u/%u: %s", instance_index_, num_instances_,
+               counters_.Snapshot().ToString().c_str());
+      next_stats_dump_ = now + stats_dump_interval_;
+    }
+  }
+}
+
+auto BufferPoolManagerInstance::FlushDirtyFrames(size_t max_pages) -> size_t {
+  size_t written = 0;
+  //从上次停下的地方沿脏页位图扫一圈，干净的frame碰都不碰
+  const size_t start = flusher_cursor_;
+  size_t from = start;
+  bool wrapped = false;
+  while (written < max_pages) {
+    auto fid = frame_descriptors_.FindDirty(from);
+    if (fid < 0 && !wrapped) {
+      wrapped = true;
+      from = 0;
+      continue;
+    }
+    if (fid < 0 || (wrapped && static_cast<size_t>(fid) >= start)) {
+      break;
+    }
+    from = fid + 1;
+    flusher_cursor_ = from % max_pool_size_;
+    //描述符都是原子的，不加锁粗筛：还pin着的跳过，上一轮之后被用过的也先放过，它多半还会再被改
+    if (frame_descriptors_.GetPinCount(fid) > 0 || frame_descriptors_.TestAndClearReferenced(fid)) {
+      continue;
+    }
+    //DiskManager的读写都在latch_下串行，写回也一样
+    //写的时候占住frame，命中路径pin不上，只能去等latch_，不会读到写了一半的page
+    std::lock_guard<std::mutex> guard(latch_);
+    if (!frame_descriptors_.TryClaim(fid)) {
+      continue;
+    }
+    auto p = &pages_[fid];
+    if (p->GetPageId() != INVALID_PAGE_ID && p->IsDirty() && CanWriteBack(p)) {
+      WriteBack(p->GetPageId(), p);
+      frame_descriptors_.SetDirty(fid, false);
+      written++;
+    }
+    frame_descriptors_.SetPinCount(fid, 0);
+  }
+  return written;
+}
+
+void BufferPoolManagerInstance::Prefetch(page_id_t page_id) {
+  //还没分配的page不能读：之后NewPage会用同一个id再绑一个frame
+  if (page_id < 0 || page_id >= next_page_id_.load() ||
+      page_id % static_cast<page_id_t>(num_instances_) != static_cast<page_id_t>(instance_index_)) {
+    return;
+  }
+  frame_id_t fid;
+  if (page_table_.Find(page_id, &fid)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(prefetch_latch_);
+    //只是提示，队列满了直接丢
+    if (prefetch_queue_.size() >= PREFETCH_QUEUE_SIZE) {
+      return;
+    }
+    prefetch_queue_.push_back(page_id);
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::RunPrefetcher() {
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] { return prefetch_stop_ || !prefetch_queue_.empty(); });
+    if (prefetch_stop_) {
+      return;
     }
+    std::vector<page_id_t> hinted(prefetch_queue_.begin(), prefetch_queue_.end());
+    prefetch_queue_.clear();
+    lock.unlock();
+    LoadPrefetched(hinted);
+    lock.lock();
   }
 }
 
-auto BufferPoolManagerInstance::PickPageFromFreeListOrReplacer() -> frame_id_t {
+auto BufferPoolManagerInstance::LoadPrefetched(const std::vector<page_id_t> &page_ids, bool evict) -> size_t {
+  std::vector<page_id_t> read_ids;
+  std::vector<char *> read_buffers;
+  std::vector<frame_id_t> read_frames;
+  std::lock_guard<std::mutex> guard(latch_);
+  for (auto page_id : page_ids) {
+    frame_id_t fid;
+    if (page_table_.Find(page_id, &fid) || std::find(read_ids.begin(), read_ids.end(), page_id) != read_ids.end()) {
+      continue;
+    }
+    if (!evict && free_list_.empty()) {
+      break;
+    }
+    fid = PickPageFromFreeListOrReplacer(page_id);
+    if (fid < 0) {
+      break;
+    }
+    read_ids.push_back(page_id);
+    read_buffers.push_back(pages_[fid].GetData());
+    read_frames.push_back(fid);
+  }
+  disk_manager_->ReadPages(read_ids, read_buffers);
+  for (size_t i = 0; i < read_ids.size(); ++i) {
+    auto fid = read_frames[i];
+    //读进来不pin，放开占用直接进replacer，等着被FetchPage命中
+    frame_descriptors_.SetPinCount(fid, 0);
+    page_table_.Insert(read_ids[i], fid);
+    replacer_->Unpin(fid);
+  }
+  counters_.RecordPrefetched(read_ids.size());
+  return read_ids.size();
+}
+
+auto BufferPoolManagerInstance::SaveWarmupSnapshot(const std::string &path) -> bool {
+  std::vector<page_id_t> page_ids;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    std::vector<frame_id_t> order;
+    replacer_->EvictionOrder(&order);
+    //在淘汰顺序里越靠后越新，不在replacer里的记0
+    std::vector<size_t> recency(max_pool_size_, 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+      recency[order[i]] = i + 1;
+    }
+    //持有latch_时占住的frame都是空的，其余的都装着page
+    std::vector<std::tuple<bool, bool, size_t, page_id_t>> resident;
+    for (size_t i = 0; i < pool_size_.load(); ++i) {
+      auto fid = static_cast<frame_id_t>(i);
+      auto pin_count = frame_descriptors_.GetPinCount(fid);
+      if (pin_count == FrameDescriptorTable::CLAIMED) {
+        continue;
+      }
+      //命中路径不动replacer，被命中过的只留下了引用位，比replacer里的顺序更新
+      resident.emplace_back(pin_count > 0, frame_descriptors_.IsReferenced(fid), recency[fid],
+                            frame_descriptors_.GetPageId(fid));
+    }
+    std::sort(resident.begin(), resident.end(), std::greater<>());
+    for (auto &entry : resident) {
+      page_ids.push_back(std::get<3>(entry));
+    }
+  }
+  //先写临时文件再改名，中途崩溃不会留下半个快照
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    uint32_t header[4] = {WARMUP_MAGIC, num_instances_, instance_index_, static_cast<uint32_t>(page_ids.size())};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(page_ids.data()),
+              static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)));
+    if (!out.good()) {
+      return false;
+    }
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+auto BufferPoolManagerInstance::LoadWarmupSnapshot(const std::string &path) -> bool {
+  std::ifstream in(path, std::ios::binary);
+  uint32_t header[4];
+  if (!in.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] != WARMUP_MAGIC ||
+      header[1] != num_instances_ || header[2] != instance_index_) {
+    return false;
+  }
+  std::vector<page_id_t> page_ids(header[3]);
+  if (!in.read(reinterpret_cast<char *>(page_ids.data()),
+               static_cast<std::streamsize>(page_ids.size() * sizeof(page_id_t)))) {
+    return false;
+  }
+  //只要最新的那部分，放得下就行；按page id排序，读盘尽量顺序
+  if (page_ids.size() > pool_size_.load()) {
+    page_ids.resize(pool_size_.load());
+  }
+  std::sort(page_ids.begin(), page_ids.end());
+  page_ids.erase(std::unique(page_ids.begin(), page_ids.end()), page_ids.end());
+  page_ids.erase(std::remove_if(page_ids.begin(), page_ids.end(),
+                                [this](page_id_t page_id) {
+                                  return page_id < 0 || page_id % static_cast<page_id_t>(num_instances_) !=
+                                                            static_cast<page_id_t>(instance_index_);
+                                }),
+                 page_ids.end());
+  if (!page_ids.empty()) {
+    //快照里的page都分配过，重启后不能再分配出去
+    std::lock_guard<std::mutex> guard(latch_);
+    if (next_page_id_ <= page_ids.back()) {
+      next_page_id_ = page_ids.back() + static_cast<page_id_t>(num_instances_);
+    }
+  }
+  if (warmup_thread_.joinable()) {
+    warmup_stop_ = true;
+    warmup_thread_.join();
+  }
+  warmup_stop_ = false;
+  warmup_thread_ = std::thread(&BufferPoolManagerInstance::RunWarmup, this, std::move(page_ids));
+  return true;
+}
+
+void BufferPoolManagerInstance::EnableWarmup(const std::string &path) {
+  warmup_path_ = path;
+  LoadWarmupSnapshot(path);
+}
+
+void BufferPoolManagerInstance::RunWarmup(std::vector<page_id_t> page_ids) {
+  //一批一批来，每批只占一次latch_，前台的miss不会等太久
+  for (size_t begin = 0; begin < page_ids.size() && !warmup_stop_; begin += WARMUP_BATCH_SIZE) {
+    auto end = std::min(begin + WARMUP_BATCH_SIZE, page_ids.size());
+    std::vector<page_id_t> batch(page_ids.begin() + begin, page_ids.begin() + end);
+    //只用空frame，不把已经在用的page挤出去
+    LoadPrefetched(batch, false);
+  }
+}
+
+void BufferPoolManagerInstance::DetectSequentialAccess(page_id_t page_id) {
+  auto window = static_cast<page_id_t>(read_ahead_pages_.load(std::memory_order_relaxed));
+  if (window == 0) {
+    return;
+  }
+  //本实例的page按num_instances_跨步分配，顺序扫描时每次正好前进一个跨步
+  auto stride = static_cast<page_id_t>(num_instances_);
+  if (last_fetched_.exchange(page_id, std::memory_order_relaxed) != page_id - stride) {
+    return;
+  }
+  //窗口跟着扫描往前滑，已经提示过的不再提示
+  page_id_t last = page_id + window * stride;
+  page_id_t next = read_ahead_next_.load(std::memory_order_relaxed);
+  page_id_t from = (next > page_id && next <= last) ? next : page_id + stride;
+  for (page_id_t p = from; p <= last; p += stride) {
+    Prefetch(p);
+  }
+  read_ahead_next_.store(last + stride, std::memory_order_relaxed);
+}
+
+auto BufferPoolManagerInstance::Resize(size_t new_pool_size) -> bool {
+  if (new_pool_size == 0 || new_pool_size > max_pool_size_) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(latch_);
+  const size_t old_pool_size = pool_size_.load();
+  if (new_pool_size >= old_pool_size) {
+    //扩容：多出来的frame从构造起就是占住的，和free list里的frame一样，直接放进去
+    for (size_t i = old_pool_size; i < new_pool_size; ++i) {
+      free_list_.emplace_back(static_cast<frame_id_t>(i));
+    }
+    pool_size_.store(new_pool_size);
+    return true;
+  }
+  //缩容：要腾空的区域里的空frame先从free list拿出来，剩下的free list都在新大小以内，用来接收挪过来的page
+  std::vector<frame_id_t> vacant;
+  free_list_.remove_if([&](frame_id_t fid) {
+    if (static_cast<size_t>(fid) < new_pool_size) {
+      return false;
+    }
+    vacant.push_back(fid);
+    return true;
+  });
+  //从最高的frame往下腾，碰到pin住的就停下，保证在用的frame总是[0, pool_size_)
+  size_t pool_size = old_pool_size;
+  while (pool_size > new_pool_size && VacateFrame(static_cast<frame_id_t>(pool_size - 1))) {
+    pool_size--;
+  }
+  //没腾到的空frame还在池子里，放回free list
+  for (auto fid : vacant) {
+    if (static_cast<size_t>(fid) < pool_size) {
+      free_list_.push_back(fid);
+    }
+  }
+  pool_size_.store(pool_size);
+  frame_arena_.ReleaseFrames(static_cast<frame_id_t>(pool_size), old_pool_size - pool_size);
+  return pool_size == new_pool_size;
+}
+
+auto BufferPoolManagerInstance::VacateFrame(frame_id_t fid) -> bool {
+  //持有latch_时，占住的frame只可能是空frame：装入和写回都在latch_下完成
+  if (frame_descriptors_.GetPinCount(fid) == FrameDescriptorTable::CLAIMED) {
+    return true;
+  }
+  //和换出一样先占住，命中路径就pin不上了；占不住说明正被pin着，挪不动
+  if (!frame_descriptors_.TryClaim(fid)) {
+    return false;
+  }
+  auto p = &pages_[fid];
+  auto page_id = p->GetPageId();
+  bool dirty = p->IsDirty();
+  if (!free_list_.empty()) {
+    //有空frame就把page挪过去，不用写盘，也不丢缓存
+    auto target = free_list_.front();
+    free_list_.pop_front();
+    memcpy(pages_[target].GetData(), p->GetData(), PAGE_SIZE);
+    frame_descriptors_.Reset(target, page_id);
+    frame_descriptors_.SetDirty(target, dirty);
+    page_table_.Remove(page_id);
+    frame_descriptors_.SetPinCount(target, 0);
+    page_table_.Insert(page_id, target);
+    replacer_->Unpin(target);
+  } else {
+    if (dirty) {
+      if (!CanWriteBack(p)) {
+        frame_descriptors_.SetPinCount(fid, 0);
+        return false;
+      }
+      WriteBack(page_id, p);
+    }
+    page_table_.Remove(page_id);
+    counters_.RecordEviction(dirty);
+  }
+  //不再用的frame留在占住的状态，也不在replacer里
+  replacer_->Remove(fid);
+  frame_descriptors_.Reset(fid, INVALID_PAGE_ID);
+  return true;
+}
+
+auto BufferPoolManagerInstance::TryPinResident(page_id_t page_id, frame_id_t fid) -> bool {
+  //正在装入、写回或者在free list里的frame是占住的，pin不上
+  if (!frame_descriptors_.TryPin(fid)) {
+    return false;
+  }
+  //查页表和pin之间，这个frame可能已经被换绑给别的page了，当成一次普通的unpin撤销
+  if (frame_descriptors_.GetPageId(fid) != page_id) {
+    if (frame_descriptors_.PinCountDown(fid) == 0) {
+      replacer_->Unpin(fid);
+    }
+    return false;
+  }
+  //不动replacer：frame留在里面，换出时发现被pin了再拿掉
+  //LRU-K按访问历史排序，命中要记进历史(只记时间戳，不拿replacer的锁)；其余replacer靠引用位让它多活一轮
+  if (!replacer_->RecordAccess(fid)) {
+    frame_descriptors_.SetReferenced(fid);
+  }
+  return true;
+}
+
+auto BufferPoolManagerInstance::AllFramesPinned() -> bool {
+  //replacer_->Size()只反映当前时刻，之后有frame被unpin也没关系，和调用前就失败一样
+  return free_list_.empty() && replacer_->Size() == 0;
+}
+
+auto BufferPoolManagerInstance::PickPageFromFreeListOrReplacer(page_id_t page_id) -> frame_id_t {
   frame_id_t fid = -1;
   if (free_list_.size() != 0) {
     fid = free_list_.front();
     free_list_.pop_front();
-    //获取page后需要pin这个page
-    pages_[fid].PinCountUp();
-  } else if (replacer_->Victim(&fid)) {
-    
-    pages_[fid].PinCountUp();
+    //free list里的frame本来就是占住的
+    frame_descriptors_.Reset(fid, page_id);
+    return fid;
   }
-
-  return fid;
+  //日志还没落盘的脏页暂时不能换出，先放一边，选完再放回replacer
+  std::vector<frame_id_t> wal_blocked;
+  frame_id_t picked = -1;
+  //最多给pool_size_次第二次机会，命中一直不断也能选出来
+  size_t second_chances = 0;
+  while (picked < 0 && replacer_->Victim(&fid)) {
+    //上次换出之后被命中过：清掉引用位，放回replacer最新的一端
+    //replacer自己记访问的(LRU-K)不会有引用位
+    if (second_chances < pool_size_.load() && frame_descriptors_.TestAndClearReferenced(fid)) {
+      second_chances++;
+      replacer_->Unpin(fid);
+      continue;
+    }
+    //命中路径pin的时候不拿掉replacer里的frame，占不住说明正被pin着，它unpin时会带着访问历史重新进replacer
+    if (!frame_descriptors_.TryClaim(fid)) {
+      continue;
+    }
+    auto p = &pages_[fid];
+    // 2.     If R is dirty, write it back to the disk.
+    //        后台flusher一般已经写过了，这里是兜底；dirty_evictions多说明flusher跟不上
+    bool dirty = p->IsDirty();
+    if (dirty) {
+      if (!CanWriteBack(p)) {
+        frame_descriptors_.SetPinCount(fid, 0);
+        wal_blocked.push_back(fid);
+        continue;
+      }
+      WriteBack(p->GetPageId(), p);
+    }
+    // 3.     Delete R from the page table
+    page_table_.Remove(p->GetPageId());
+    counters_.RecordEviction(dirty);
+    //真要装新page了，这时才清掉旧page的访问历史
+    replacer_->Remove(fid);
+    frame_descriptors_.Reset(fid, page_id);
+    picked = fid;
+  }
+  //历史还在，放回去只多记一次访问，暂时写不了的脏页下次也晚一点再轮到
+  for (auto blocked : wal_blocked) {
+    replacer_->Unpin(blocked);
+  }
+  return picked;
 }
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
-  // 0.   Make sure you call AllocatePage!
-  auto page_id_ = AllocatePage();
+  auto guard = counters_.LockAndRecordWait(&latch_);
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
-  bool allpin = true;
-  for (size_t i = 0; i < pool_size_; ++i) {
-    if(pages_[i].GetPinCount()==0){
-      allpin=false;
-    }
-  }
-  if (allpin) {
+  //        没被pin的frame不是在free list里就是在replacer里，两个计数都是O(1)
+  if (AllFramesPinned()) {
     // printf("page all pin\n");
     return nullptr;
   }
   // 2.   Pick a victim page P from either the free list or the replacer.
   //        Always pick from the free list first.
-  frame_id_t fid = PickPageFromFreeListOrReplacer();
+  //        先不绑page id，拿到frame再分配，失败时不会白白用掉一个id
+  frame_id_t fid = PickPageFromFreeListOrReplacer(INVALID_PAGE_ID);
   if (fid < 0) {
     // printf("no page left in freelist or replacer\n");
     return nullptr;
   }
+  // 0.   Make sure you call AllocatePage!
+  auto page_id_ = AllocatePage();
   Page *p=&pages_[fid];
   // 3.   Update P's metadata, zero out memory and add P to the page table.
-  p->page_id_ = page_id_;
-  page_table_[page_id_] = fid;
+  //      frame还占着，清零之后再pin上放开
+  frame_descriptors_.SetPageId(fid, page_id_);
+  memset(p->GetData(), 0, PAGE_SIZE);
+  frame_descriptors_.SetPinCount(fid, 1);
+  page_table_.Insert(page_id_, fid);
   // 4.   Set the page ID output parameter. Return a pointer to P.
   *page_id = page_id_;
 
@@ -123,84 +593,184 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
 
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   // 1.     Search the page table for the requested page (P).
-  auto find = page_table_.find(page_id);
   // 1.1    If P exists, pin it and return it immediately.
-  if (find != page_table_.end()) {
-    auto p = &pages_[find->second];
-    p->PinCountUp();
-    replacer_->Pin(find->second);
-    return p;
-  } else {
-    // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
-    //        Note that pages are always found from the free list first.
-    auto fid = PickPageFromFreeListOrReplacer();
-    if (fid < 0) {
-      // printf("should have a useable page");
-      return nullptr;
+  //        命中不拿latch_：无锁查页表，原子地pin上frame
+  DetectSequentialAccess(page_id);
+  frame_id_t fid;
+  if (page_table_.Find(page_id, &fid) && TryPinResident(page_id, fid)) {
+    counters_.RecordHit();
+    return &pages_[fid];
+  }
+  auto guard = counters_.LockAndRecordWait(&latch_);
+  //拿到latch_后再查一次，可能别的线程刚把它读进来
+  if (page_table_.Find(page_id, &fid) && TryPinResident(page_id, fid)) {
+    counters_.RecordHit();
+    return &pages_[fid];
+  }
+  counters_.RecordMiss();
+  // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
+  //        Note that pages are always found from the free list first.
+  // 2.     If R is dirty, write it back to the disk.
+  // 3.     Delete R from the page table and insert P.
+  fid = PickPageFromFreeListOrReplacer(page_id);
+  if (fid < 0) {
+    // printf("should have a useable page");
+    return nullptr;
+  }
+  // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
+  //        读的时候frame占着，读完才pin上放开、进页表，命中路径看不到读了一半的page
+  auto p = &pages_[fid];
+  disk_manager_->ReadPage(page_id, p->GetData());
+  frame_descriptors_.SetPinCount(fid, 1);
+  page_table_.Insert(page_id, fid);
+  return p;
+}
+
+auto BufferPoolManagerInstance::FetchPages(const std::vector<page_id_t> &page_ids) -> std::vector<Page *> {
+  std::vector<Page *> result(page_ids.size(), nullptr);
+  //miss的page先占好frame，最后一次性读盘，读完再进页表
+  std::vector<page_id_t> read_ids;
+  std::vector<char *> read_buffers;
+  std::vector<frame_id_t> read_frames;
+  //读完之后每个frame要pin几次
+  std::vector<int> read_pins;
+  auto guard = counters_.LockAndRecordWait(&latch_);
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    auto page_id = page_ids[i];
+    frame_id_t fid;
+    if (page_table_.Find(page_id, &fid) && TryPinResident(page_id, fid)) {
+      counters_.RecordHit();
+      result[i] = &pages_[fid];
+      continue;
     }
-    // 2.     If R is dirty, write it back to the disk.
-    auto p = &pages_[fid];
-    if (p->IsDirty()) {
-      disk_manager_->WritePage(p->GetPageId(), p->GetData());
+    //同一批里重复出现、正在等着读的page，再pin一次
+    auto loading = std::find(read_ids.begin(), read_ids.end(), page_id);
+    if (loading != read_ids.end()) {
+      fid = read_frames[loading - read_ids.begin()];
+      read_pins[loading - read_ids.begin()]++;
+      counters_.RecordHit();
+      result[i] = &pages_[fid];
+      continue;
     }
-    // 3.     Delete R from the page table and insert P.
-    page_table_.erase(p->GetPageId());
-    page_table_[page_id]=fid;
-    // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-    auto addr=p->NewDiskPageBind(page_id);
-    disk_manager_->ReadPage(page_id,addr);
-
-    return p;
+    counters_.RecordMiss();
+    fid = PickPageFromFreeListOrReplacer(page_id);
+    if (fid < 0) {
+      continue;
+    }
+    read_ids.push_back(page_id);
+    read_buffers.push_back(pages_[fid].GetData());
+    read_frames.push_back(fid);
+    read_pins.push_back(1);
+    result[i] = &pages_[fid];
   }
+  disk_manager_->ReadPages(read_ids, read_buffers);
+  for (size_t i = 0; i < read_ids.size(); ++i) {
+    frame_descriptors_.SetPinCount(read_frames[i], read_pins[i]);
+    page_table_.Insert(read_ids[i], read_frames[i]);
+  }
+  return result;
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
-  // 0.   Make sure you call DeallocatePage!
-  DeallocatePage(page_id);
+  std::lock_guard<std::mutex> guard(latch_);
   // 1.   Search the page table for the requested page (P).
   auto res=GetPageByPageId(page_id);
   auto find=res.page;
   auto fid=res.fid;
   // 1.   If P does not exist, return true.
+  // 0.   Make sure you call DeallocatePage!
+  //      删除失败的page还在用，不能释放，只在返回true的地方释放
   if(find==nullptr){
+    DeallocatePage(page_id);
     return true;
   }
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
-  else if(find->GetPinCount()>0){
+  //      占住之后命中路径就pin不上了，free list里的frame一直占着
+  if(!frame_descriptors_.TryClaim(fid)){
     return false;
   }
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  else{
-    page_table_.erase(page_id);
-    free_list_.emplace_back(fid);
-    return true;
-  }
+  page_table_.Remove(page_id);
+  //从replacer拿掉，免得同一个frame既在free list又在replacer；访问历史跟着page一起作废
+  replacer_->Remove(fid);
+  frame_descriptors_.Reset(fid, INVALID_PAGE_ID);
+  free_list_.emplace_back(fid);
+  DeallocatePage(page_id);
+  return true;
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(
   page_id_t page_id, bool is_dirty) -> bool {
     auto res=GetPageByPageId(page_id);
-    if(res.page){
-      res.page->PinCountDown();
-      if(is_dirty){
-        FlushPage(page_id);
-      }
-      if(res.page->GetPinCount()==0){
-
-        replacer_->Unpin(page_table_[page_id]);
-        page_table_.erase(page_id);//
-        return true;
-      }
+    if(res.page==nullptr){
+      return false;
+    }
+    //调用者还pin着，frame不会被换绑
+    if(res.page->GetPageId()!=page_id||res.page->GetPinCount()<=0){
+      return false;
+    }
+    //只标脏，写回交给后台flusher或者换出；先标脏再unpin，flusher才不会漏写
+    if(is_dirty){
+      frame_descriptors_.SetDirty(res.fid, true);
+    }
+    int pin_count;
+    if(!frame_descriptors_.TryUnpin(res.fid, &pin_count)){
+      return false;
     }
-   return false; }
+    if(pin_count==0){
+      replacer_->Unpin(res.fid);
+    }
+    return true;
+}
 
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
+  //先复用释放过的、模num_instances_落在本实例的id；旧副本还被pin着的id先跳过，最后还回去
+  std::vector<page_id_t> skipped;
+  page_id_t page_id;
+  while ((page_id = disk_manager_->ReuseFreePage(num_instances_, instance_index_)) != INVALID_PAGE_ID &&
+         !DropStaleCopy(page_id)) {
+    skipped.push_back(page_id);
+  }
+  for (auto skipped_id : skipped) {
+    disk_manager_->DeallocatePage(skipped_id);
+  }
+  if (page_id != INVALID_PAGE_ID) {
+    ValidatePageId(page_id);
+    return page_id;
+  }
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
+  //DiskManager只接受分配过的id的释放
+  disk_manager_->MarkPageAllocated(next_page_id);
   ValidatePageId(next_page_id);
   return next_page_id;
 }
 
+void BufferPoolManagerInstance::DeallocatePage(page_id_t page_id) {
+  //没分配过的、不归本实例的id不能进空闲表，否则之后会被当成新page发出去
+  if (page_id < 0 || page_id >= next_page_id_.load() ||
+      page_id % static_cast<page_id_t>(num_instances_) != static_cast<page_id_t>(instance_index_)) {
+    return;
+  }
+  disk_manager_->DeallocatePage(page_id);
+}
+
+auto BufferPoolManagerInstance::DropStaleCopy(page_id_t page_id) -> bool {
+  frame_id_t fid;
+  if (!page_table_.Find(page_id, &fid)) {
+    return true;
+  }
+  //删掉的page被prefetch之类读回来了，没人用的话直接扔，不用写回
+  if (!frame_descriptors_.TryClaim(fid)) {
+    return false;
+  }
+  page_table_.Remove(page_id);
+  replacer_->Remove(fid);
+  frame_descriptors_.Reset(fid, INVALID_PAGE_ID);
+  free_list_.emplace_back(fid);
+  return true;
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
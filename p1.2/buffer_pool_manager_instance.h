@@ -12,12 +12,24 @@
 
 #pragma once
 
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
 #include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <tuple>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/concurrent_page_table.h"
+#include "buffer/frame_arena.h"
+#include "buffer/frame_descriptor_table.h"
+#include "buffer/intrusive_lru_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -25,6 +37,16 @@
 
 namespace bustub {
 
+/** Replacement policy used by a BufferPoolManagerInstance. */
+enum class ReplacerType {
+  /** Plain LRU, cheapest, but a single sequential scan flushes the whole working set. */
+  LRU,
+  /** Same policy as LRU, on a preallocated array indexed by frame id: no allocation or hashing per Pin/Unpin. */
+  INTRUSIVE_LRU,
+  /** LRU-K, scan resistant: pages referenced fewer than K times are evicted first. */
+  LRU_K,
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
@@ -44,9 +66,17 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of this BPI
+   * @param lru_k K of the LRU-K replacer, ignored for other policies
+   * @param arena_options huge page and NUMA placement of the frame data
+   * @param max_pool_size most frames Resize() may grow the pool to, 0 means pool_size. Frame data is only backed by
+   * memory once it is used, but page metadata is allocated for all max_pool_size frames up front (and so are explicit
+   * huge pages, if the system has them reserved)
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU, size_t lru_k = 2,
+                            const FrameArenaOptions &arena_options = {}, size_t max_pool_size = 0);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -54,14 +84,138 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   ~BufferPoolManagerInstance() override;
 
   /** @return size of the buffer pool */
-  auto GetPoolSize() -> size_t override { return pool_size_; }
+  auto GetPoolSize() -> size_t override { return pool_size_.load(std::memory_order_relaxed); }
+
+  /** @return the most frames the buffer pool can grow to */
+  auto GetMaxPoolSize() -> size_t { return max_pool_size_; }
+
+  /**
+   * Grow or shrink the buffer pool while it is in use. Growing hands frames up to new_pool_size to the free list.
+   * Shrinking vacates the frames at the top of the pool: their pages move to free frames below new_pool_size, or are
+   * evicted when there are none, and the memory of the vacated frames goes back to the OS. Pinned frames cannot be
+   * vacated, so shrinking stops at the highest pinned frame; call again once it is unpinned.
+   * @param new_pool_size number of frames, between 1 and GetMaxPoolSize()
+   * @return true if the pool now has new_pool_size frames
+   */
+  auto Resize(size_t new_pool_size) -> bool;
 
   /** @return pointer to all the pages in the buffer pool */
   auto GetPages() -> Page * { return pages_; }
 
+  /** @return the memory holding the frame data, e.g. to check whether it got huge pages */
+  auto GetFrameArena() -> const FrameArena & { return frame_arena_; }
+
+  /**
+   * Fetch and pin a batch of pages with a single acquisition of latch_. All misses are read from disk in one batch.
+   * Every non-null result must be unpinned by the caller, once per occurrence of its page id in the batch.
+   * @param page_ids ids of the pages to fetch, all owned by this BPI
+   * @return one page per page id, nullptr where no frame was available
+   */
+  auto FetchPages(const std::vector<page_id_t> &page_ids) -> std::vector<Page *>;
+
+  /** @return a snapshot of the hit/miss/eviction/write-back counters of this BPI */
+  auto GetStats() -> BufferPoolStats { return counters_.Snapshot(); }
+
+  /**
+   * Periodically log the counters of this BPI through LOG_INFO, from the background flusher.
+   * @param interval time between two dumps, 0 turns dumping off (the default)
+   */
+  void SetStatsDumpInterval(std::chrono::milliseconds interval);
+
+  /**
+   * Hint that page_id will be fetched soon. The page is read by a background thread and left unpinned in the replacer,
+   * so the FetchPage that follows is a hit. Hints are dropped when the page is resident, not allocated by this BPI,
+   * no frame can be freed, or too many hints are already queued.
+   * @param page_id id of the page to read ahead
+   */
+  void Prefetch(page_id_t page_id);
+
+  /**
+   * Write the ids of the resident pages to path, most recently used first: pinned pages, then pages hit since they
+   * last came up for eviction, then the rest in reverse replacer order. Call it at checkpoints; EnableWarmup also
+   * writes one when the BPI is destroyed.
+   * @param path file to write, replaced atomically
+   * @return false if the file could not be written
+   */
+  auto SaveWarmupSnapshot(const std::string &path) -> bool;
+
+  /**
+   * Read the pages of a snapshot written by SaveWarmupSnapshot back in the background. Only the pool size most recent
+   * entries are read, in ascending page id order and WARMUP_BATCH_SIZE pages per batched disk read and per latch_
+   * acquisition, so foreground fetches keep going meanwhile. Warm-up never evicts: it only fills free frames, and pages
+   * fetched in the meantime are skipped. Loaded pages count as prefetched in GetStats().
+   * @param path snapshot file
+   * @return false if there is no valid snapshot of this BPI at path
+   */
+  auto LoadWarmupSnapshot(const std::string &path) -> bool;
+
+  /**
+   * Warm the pool up from the snapshot at path, if there is one, and write a new snapshot there on shutdown.
+   * @param path snapshot file
+   */
+  void EnableWarmup(const std::string &path);
+
+  /**
+   * Turn on sequential read-ahead. Once FetchPage sees two consecutive pages of this BPI, the next num_pages pages
+   * are prefetched, and the window slides forward as the scan goes on.
+   * @param num_pages how many pages to keep ahead of a sequential scan, 0 turns read-ahead off (the default)
+   */
+  void SetReadAhead(size_t num_pages) { read_ahead_pages_.store(num_pages, std::memory_order_relaxed); }
+
  protected:
-  //取一个空闲page，给新的物理page绑定
-  auto PickPageFromFreeListOrReplacer()->frame_id_t;
+  //取一个空闲page，给新的物理page绑定，返回时frame是占住的(CLAIMED)，装好数据后由调用者设置pin计数放开
+  //调用者需持有latch_
+  auto PickPageFromFreeListOrReplacer(page_id_t page_id)->frame_id_t;
+
+  //free list和replacer都空了，说明所有frame都被pin住，O(1)
+  //调用者需持有latch_
+  auto AllFramesPinned()->bool;
+
+  //缩容时腾空一个frame：page挪到free list里的frame上，没有空frame就换出；frame被pin着返回false
+  //调用者需持有latch_
+  auto VacateFrame(frame_id_t fid) -> bool;
+
+  //命中路径：不拿任何锁，原子地pin住这个frame，再确认它还装着page_id
+  auto TryPinResident(page_id_t page_id, frame_id_t fid)->bool;
+
+  //WAL：page最新修改对应的日志落盘之后，page才能写回
+  auto CanWriteBack(Page *page)->bool;
+
+  //写盘并记下耗时，所有写回都走这里
+  void WriteBack(page_id_t page_id, Page *page);
+
+  //FlushPage/FlushAllPages写一个frame：日志先落盘，写成功且frame没被pin时才清脏位
+  //调用者需持有latch_
+  void FlushFrame(frame_id_t fid);
+
+  /**
+   * Background flusher loop: every FLUSHER_INTERVAL, write back a batch of dirty, unpinned frames, and dump the
+   * counters when SetStatsDumpInterval asked for it.
+   */
+  void RunBackgroundFlusher();
+
+  /**
+   * Write back up to max_pages dirty, unpinned frames, continuing the sweep where the last call stopped. Only the dirty
+   * bitmap is scanned; frames referenced since the last sweep are skipped once, they are likely to be written again.
+   * @return the number of pages written
+   */
+  auto FlushDirtyFrames(size_t max_pages)->size_t;
+
+  /** Background prefetcher loop: drain the hint queue and read the hinted pages in one batch. */
+  void RunPrefetcher();
+
+  /**
+   * Read the given pages into unpinned frames with one batched disk read, skipping resident ones.
+   * @param evict whether frames may be taken from the replacer, or only from the free list
+   * @return the number of pages read
+   */
+  auto LoadPrefetched(const std::vector<page_id_t> &page_ids, bool evict = true)->size_t;
+
+  /** Warm-up thread: read the sorted page ids batch by batch into free frames. */
+  void RunWarmup(std::vector<page_id_t> page_ids);
+
+  //FetchPage调用：识别顺序扫描，提前提示后面的page
+  void DetectSequentialAccess(page_id_t page_id);
 
   struct GetPageByPageIdRet{
     frame_id_t fid;
@@ -111,17 +265,23 @@ class BufferPoolManagerInstance : public BufferPoolManager {
 
   /**
    * Allocate a page on disk.∂
+   * Deallocated page ids of this BPI are reused first, lowest first, so the database file stays compact.
    * @return the id of the allocated page
    */
   auto AllocatePage() -> page_id_t;
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk. The disk manager keeps the id in its free page map until AllocatePage reuses it.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Drop the copy of a deallocated page that was read back into the pool after it was deleted, e.g. by a prefetch
+   * hint, so that its id can be reused. Must be called with latch_ held.
+   * @return false if the copy is pinned and the id cannot be reused yet
+   */
+  auto DropStaleCopy(page_id_t page_id) -> bool;
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -130,8 +290,21 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  /** How often the background flusher wakes up. */
+  static constexpr std::chrono::milliseconds FLUSHER_INTERVAL{10};
+  /** Maximum number of pages the background flusher writes back per wakeup. */
+  static constexpr size_t FLUSHER_BATCH_SIZE = 32;
+  /** Maximum number of queued Prefetch hints, further hints are dropped. */
+  static constexpr size_t PREFETCH_QUEUE_SIZE = 64;
+  /** Number of pages the warm-up reads per batch. */
+  static constexpr size_t WARMUP_BATCH_SIZE = 64;
+  /** First word of a warm-up snapshot file. */
+  static constexpr uint32_t WARMUP_MAGIC = 0x57415255;
+
+  /** Number of pages in the buffer pool, frames [0, pool_size_) are in use. Changes under latch_, see Resize(). */
+  std::atomic<size_t> pool_size_;
+  /** Number of frames the arena, page array and metadata are allocated for. */
+  const size_t max_pool_size_;
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
@@ -139,19 +312,54 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
   std::atomic<page_id_t> next_page_id_ = instance_index_;
 
+  /** Frame data of all pages, kept apart from the Page metadata. */
+  FrameArena frame_arena_;
+  /** Page id, pin count, dirty and reference bit of every frame, kept apart from the frame data. */
+  FrameDescriptorTable frame_descriptors_;
   /** Array of buffer pool pages. */
   Page *pages_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  /** Page table for keeping track of buffer pool pages. Lookups are latch-free, updates happen under latch_. */
+  ConcurrentPageTable page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
-  /** List of free pages. */
+  /** List of free pages. Frames beyond pool_size_ are in neither the free list nor the replacer. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** Access counters, see GetStats(). */
+  BufferPoolCounters counters_;
+  /** Background flusher: keeps unpinned frames clean so that eviction rarely has to write. */
+  std::thread flusher_thread_;
+  std::mutex flusher_latch_;
+  std::condition_variable flusher_cv_;
+  bool flusher_stop_ = false;
+  /** Next frame the flusher looks at; only touched by the flusher thread. */
+  size_t flusher_cursor_ = 0;
+  /** Stats dump schedule of the flusher, protected by flusher_latch_. */
+  std::chrono::milliseconds stats_dump_interval_{0};
+  std::chrono::steady_clock::time_point next_stats_dump_;
+  /** Background prefetcher: reads hinted pages ahead of FetchPage. The queue is protected by prefetch_latch_. */
+  std::thread prefetch_thread_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  std::deque<page_id_t> prefetch_queue_;
+  bool prefetch_stop_ = false;
+  /** Sequential read-ahead state, see SetReadAhead(). Only a heuristic, so racing fetches may lose updates. */
+  std::atomic<size_t> read_ahead_pages_{0};
+  std::atomic<page_id_t> last_fetched_{INVALID_PAGE_ID};
+  std::atomic<page_id_t> read_ahead_next_{INVALID_PAGE_ID};
+  /** Background warm-up, see LoadWarmupSnapshot(). */
+  std::thread warmup_thread_;
+  std::atomic<bool> warmup_stop_{false};
+  /** Where EnableWarmup asked for a snapshot on shutdown, empty for none. */
+  std::string warmup_path_;
+  /**
+   * This latch protects the free list, victim selection and all page table updates. It is held whenever a frame is
+   * bound to a different page, but never on the buffer hit path: a hit pins the frame with an atomic increment, and
+   * frames being rebound are claimed in the FrameDescriptorTable so that such a pin fails.
+   */
   std::mutex latch_;
 };
 }  // namespace bustub
@@ -16,11 +16,19 @@ namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
 
-                                                     LogManager *log_manager) {
+                                                     LogManager *log_manager, const FrameArenaOptions &arena_options,
+                                                     bool numa_local_instances, size_t max_pool_size) {
   // Allocate and create individual BufferPoolManagerInstances
   bufferpool_mans.reserve(num_instances);
+  int num_nodes = FrameArena::NumNumaNodes();
   for(size_t i=0;i<num_instances;i++){
-    bufferpool_mans.emplace_back(new BufferPoolManagerInstance(pool_size,disk_manager,log_manager));
+    FrameArenaOptions options = arena_options;
+    if (numa_local_instances) {
+      //每个实例的frame放在一个node上，实例数是node数的倍数时每个node分到一样多
+      options.numa_node = static_cast<int>(i % num_nodes);
+    }
+    bufferpool_mans.emplace_back(new BufferPoolManagerInstance(
+      pool_size,num_instances,i,disk_manager,log_manager,ReplacerType::LRU,2,options,max_pool_size));
   }
 }
 
@@ -33,13 +41,64 @@ ParallelBufferPoolManager::~ParallelBufferPoolManager() {
 
 auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   // Get size of all BufferPoolManagerInstances
-  return bufferpool_mans[0]->GetPoolSize();
+  //缩容可能只完成了一部分，各实例大小不一定一样
+  size_t pool_size=0;
+  for(auto bpmi:bufferpool_mans){
+    pool_size+=bpmi->GetPoolSize();
+  }
+  return pool_size;
+}
+
+auto ParallelBufferPoolManager::Resize(size_t pool_size) -> bool {
+  bool resized=true;
+  for(auto bpmi:bufferpool_mans){
+    resized=bpmi->Resize(pool_size)&&resized;
+  }
+  return resized;
+}
+
+auto ParallelBufferPoolManager::GetInstanceStats() -> std::vector<BufferPoolStats> {
+  std::vector<BufferPoolStats> stats;
+  stats.reserve(bufferpool_mans.size());
+  for(auto bpmi:bufferpool_mans){
+    stats.push_back(bpmi->GetStats());
+  }
+  return stats;
+}
+
+auto ParallelBufferPoolManager::GetStats() -> BufferPoolStats {
+  BufferPoolStats total;
+  for(auto &s:GetInstanceStats()){
+    total+=s;
+  }
+  return total;
+}
+
+void ParallelBufferPoolManager::SetStatsDumpInterval(std::chrono::milliseconds interval) {
+  for(auto bpmi:bufferpool_mans){
+    bpmi->SetStatsDumpInterval(interval);
+  }
+}
+
+auto ParallelBufferPoolManager::SaveWarmupSnapshot(const std::string &path_prefix) -> bool {
+  bool saved=true;
+  for(size_t i=0;i<bufferpool_mans.size();i++){
+    saved=bufferpool_mans[i]->SaveWarmupSnapshot(path_prefix+"."+std::to_string(i))&&saved;
+  }
+  return saved;
+}
+
+void ParallelBufferPoolManager::EnableWarmup(const std::string &path_prefix) {
+  //每个实例一个快照文件，实例数变了的话BufferPoolManagerInstance会认出来不用
+  for(size_t i=0;i<bufferpool_mans.size();i++){
+    bufferpool_mans[i]->EnableWarmup(path_prefix+"."+std::to_string(i));
+  }
 }
 
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager * {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
-  
-  return bufferpool_mans[pageid_2_bufferpoolman[page_id]];
+  //每个实例只分配 page_id % num_instances == instance_index 的page，不用查表
+  return bufferpool_mans[page_id%bufferpool_mans.size()];
 }
 
 auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
@@ -48,6 +107,41 @@ auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
   return GetBufferPoolManager(page_id)->FetchPage(page_id);
 }
 
+auto ParallelBufferPoolManager::FetchPages(const std::vector<page_id_t> &page_ids) -> std::vector<Page *> {
+  //按负责的实例分组，每个实例一次批量fetch
+  std::vector<std::vector<page_id_t>> ids(bufferpool_mans.size());
+  std::vector<std::vector<size_t>> positions(bufferpool_mans.size());
+  for(size_t i=0;i<page_ids.size();i++){
+    auto index=page_ids[i]%bufferpool_mans.size();
+    ids[index].push_back(page_ids[i]);
+    positions[index].push_back(i);
+  }
+  std::vector<Page *> result(page_ids.size(),nullptr);
+  for(size_t index=0;index<bufferpool_mans.size();index++){
+    if(ids[index].empty()){
+      continue;
+    }
+    auto pages=bufferpool_mans[index]->FetchPages(ids[index]);
+    for(size_t j=0;j<pages.size();j++){
+      result[positions[index][j]]=pages[j];
+    }
+  }
+  return result;
+}
+
+void ParallelBufferPoolManager::Prefetch(page_id_t page_id) {
+  if(page_id==INVALID_PAGE_ID){
+    return;
+  }
+  bufferpool_mans[page_id%bufferpool_mans.size()]->Prefetch(page_id);
+}
+
+void ParallelBufferPoolManager::SetReadAhead(size_t num_pages) {
+  for(auto bpmi:bufferpool_mans){
+    bpmi->SetReadAhead(num_pages);
+  }
+}
+
 auto ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
   // Unpin page_id from responsible BufferPoolManagerInstance
   return GetBufferPoolManager(page_id)->UnpinPage(page_id,is_dirty);
@@ -63,34 +157,30 @@ auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
   // BufferPoolManagerInstances
   // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
   // starting index and return nullptr
+  // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
+  // is called
+  //起点在进入时就原子地推进，并发的NewPage从不同实例开始
+  auto begin=newpgimp_scanbegin.fetch_add(1,std::memory_order_relaxed);
   for(size_t i=0;i<bufferpool_mans.size();i++){
-    auto index=(newpgimp_scanbegin+i)%bufferpool_mans.size();
+    auto index=(begin+i)%bufferpool_mans.size();
     auto &bpmi=bufferpool_mans[index];
     auto newpg=bpmi->NewPage(page_id);
     if(newpg){
-      newpgimp_scanbegin++;newpgimp_scanbegin%=bufferpool_mans.size();
       return newpg;
     }
   }
-  // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
-  // is called
-  newpgimp_scanbegin++;newpgimp_scanbegin%=bufferpool_mans.size();
   return nullptr;
 }
 
 auto ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool {
   // Delete page_id from responsible BufferPoolManagerInstance
-  if(GetBufferPoolManager(page_id)->DeletePage(page_id)){
-    pageid_2_bufferpoolman.erase(page_id);
-    return true;
-  }
-  return false;
+  return GetBufferPoolManager(page_id)->DeletePage(page_id);
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
   // flush all pages from all BufferPoolManagerInstances
-  for(auto pair :pageid_2_bufferpoolman){
-    bufferpool_mans[pair.second]->FlushAllPages();
+  for(auto bpmi:bufferpool_mans){
+    bpmi->FlushAllPages();
   }
 }
 
@@ -12,7 +12,10 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <string>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
@@ -30,9 +33,14 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param arena_options huge page and NUMA placement of every instance's frame data
+   * @param numa_local_instances spread the instances over the NUMA nodes round-robin, instance i preferring memory on
+   * node i % number of nodes; overrides arena_options.numa_node
+   * @param max_pool_size most frames Resize() may grow each instance to, 0 means pool_size
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, const FrameArenaOptions &arena_options = {},
+                            bool numa_local_instances = false, size_t max_pool_size = 0);
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -42,6 +50,62 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /**
+   * Fetch and pin a batch of pages. The batch is split by owning instance and each instance fetches its part with
+   * one latch acquisition and one batched disk read.
+   * @param page_ids ids of the pages to fetch
+   * @return one page per page id, nullptr where no frame was available
+   */
+  auto FetchPages(const std::vector<page_id_t> &page_ids) -> std::vector<Page *>;
+
+  /**
+   * Hint that page_id will be fetched soon, see BufferPoolManagerInstance::Prefetch.
+   * @param page_id id of the page to read ahead
+   */
+  void Prefetch(page_id_t page_id);
+
+  /**
+   * Turn on sequential read-ahead in every instance, see BufferPoolManagerInstance::SetReadAhead.
+   * @param num_pages pages to keep ahead of a scan in each instance, 0 turns read-ahead off
+   */
+  void SetReadAhead(size_t num_pages);
+
+  /**
+   * Resize every instance to pool_size frames, see BufferPoolManagerInstance::Resize. The number of instances is fixed:
+   * page ids are assigned to instances by page_id % num_instances, so changing it would move every resident page.
+   * @param pool_size frames per instance, between 1 and the max_pool_size given at construction
+   * @return true if every instance now has pool_size frames
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /**
+   * Write a warm-up snapshot of every instance, instance i to path_prefix.i, see
+   * BufferPoolManagerInstance::SaveWarmupSnapshot.
+   * @return false if any snapshot could not be written
+   */
+  auto SaveWarmupSnapshot(const std::string &path_prefix) -> bool;
+
+  /**
+   * Warm every instance up from its snapshot at path_prefix.i and write new snapshots there on shutdown, see
+   * BufferPoolManagerInstance::EnableWarmup.
+   */
+  void EnableWarmup(const std::string &path_prefix);
+
+  /** @return number of BufferPoolManagerInstances */
+  auto GetNumInstances() -> size_t { return bufferpool_mans.size(); }
+
+  /** @return counters of every BufferPoolManagerInstance, indexed by instance */
+  auto GetInstanceStats() -> std::vector<BufferPoolStats>;
+
+  /** @return counters summed over all BufferPoolManagerInstances */
+  auto GetStats() -> BufferPoolStats;
+
+  /**
+   * Make every instance periodically log its counters, see BufferPoolManagerInstance::SetStatsDumpInterval.
+   * @param interval time between two dumps, 0 turns dumping off
+   */
+  void SetStatsDumpInterval(std::chrono::milliseconds interval);
+
  protected:
   /**
    * @param page_id id of page
@@ -90,8 +154,9 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
-  int newpgimp_scanbegin=0;
-  std::unordered_map<page_id_t,int> pageid_2_bufferpoolman;
+  //NewPgImp轮询的起点，多线程同时NewPage
+  std::atomic<size_t> newpgimp_scanbegin{0};
+  //page_id % 实例数 就是负责它的实例，和BufferPoolManagerInstance::AllocatePage对应
   std::vector<BufferPoolManagerInstance*> bufferpool_mans;
 };
 }  // namespace bustub